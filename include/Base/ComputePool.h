@@ -0,0 +1,64 @@
+/** 
+ * @author: yuyuyuj1e 807152541@qq.com
+ * @github: https://github.com/yuyuyuj1e
+ * @csdn: https://blog.csdn.net/yuyuyuj1e
+ * @date: 2023-03-24 10:20:37
+ * @last_edit_time: 2023-03-24 10:20:37
+ * @file_path: /CC/include/Base/ComputePool.h
+ * @description: 计算线程池头文件
+ */
+
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <functional>
+#include "EventLoop.h"
+
+/** 
+ * @description: 计算线程池，用于执行耗时的计算任务（生成目录页面、压缩、哈希等），避免阻塞反应堆模型所属线程
+ * @description: 每个计算线程拥有一个双端队列，线程从自己队列的尾部取任务（刚放入的任务数据还在缓存中），空闲时从其他线程队列的头部窃取任务
+ * @description: 计算结果通过 EventLoop::queueInLoop 交还给连接所属的反应堆模型，由反应堆模型负责发送，计算线程不接触套接字
+ */
+class ComputePool {
+public:
+	using Task = std::function<void()>;
+
+private:
+	// 每个计算线程的任务队列，只有窃取时才会与其他线程竞争同一把锁
+	struct Worker {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	int m_thread_num;  // 计算线程数量
+	std::vector<Worker*> m_workers;  // 任务队列
+	std::vector<std::thread*> m_threads;  // 计算线程
+	std::atomic<int> m_pending;  // 尚未被取走的任务数量
+	std::atomic<unsigned int> m_next;  // 外部线程提交任务时轮询选择队列
+	std::mutex m_mutex;  // 用于空闲线程休眠
+	std::condition_variable m_cond;
+	bool m_stop;  // 退出标志（由 m_mutex 保护）
+
+private:
+	void working(int index);  // 计算线程工作函数
+	bool take(int index, Task& task);  // 从自己的队列中取出任务，取不到时窃取
+
+public:
+	ComputePool(int thread_num);
+	~ComputePool();
+	ComputePool(const ComputePool&) = delete;
+	ComputePool& operator=(const ComputePool&) = delete;
+
+	void run();  // 启动计算线程
+	void submit(Task task);  // 提交任务（线程安全）
+	void submit(Task work, EventLoop* event_loop, EventLoop::Functor done);  // 执行 work 后在 event_loop 中执行 done
+	inline int getThreadNum();
+};
+
+inline int ComputePool::getThreadNum() {
+	return m_thread_num;
+}
@@ -0,0 +1,27 @@
+/** 
+ * @author: yuyuyuj1e 807152541@qq.com
+ * @github: https://github.com/yuyuyuj1e
+ * @csdn: https://blog.csdn.net/yuyuyuj1e
+ * @date: 2023-03-23 15:06:18
+ * @last_edit_time: 2023-03-23 15:06:18
+ * @file_path: /CC/include/Base/CpuAffinity.h
+ * @description: CPU 亲和性模块头文件
+ */
+
+#pragma once
+#include <thread>
+#include <string>
+#include <vector>
+
+/** 
+ * @description: 线程绑核工具，只能在 Linux 平台下使用
+ * @description: Linux 默认的内存分配策略是首次访问（first-touch），页面分配在第一次写入它的线程当前所在的 NUMA 节点上
+ * @description: 因此先绑核再申请内存，线程的反应堆模型、缓冲区等数据就会落在本地节点上，不需要额外的 NUMA 库
+ */
+class CpuAffinity {
+public:
+	static int cpuCount();  // 获取可用的 CPU 数量
+	static int bindCurrentThread(int cpu);  // 将当前线程绑定到指定 CPU
+	static int bindThread(std::thread* thread, int cpu);  // 将指定线程绑定到指定 CPU
+	static std::vector<int> nicQueueCpus(const std::string& interface);  // 获取网卡各个队列中断所在的 CPU
+};
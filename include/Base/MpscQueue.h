@@ -0,0 +1,132 @@
+/** 
+ * @author: yuyuyuj1e 807152541@qq.com
+ * @github: https://github.com/yuyuyuj1e
+ * @csdn: https://blog.csdn.net/yuyuyuj1e
+ * @date: 2023-03-21 14:30:12
+ * @last_edit_time: 2023-03-21 14:30:12
+ * @file_path: /CC/include/Base/MpscQueue.h
+ * @description: 无锁多生产者单消费者队列
+ */
+
+#pragma once
+#include <atomic>
+#include <utility>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @description: 有界无锁队列，允许多个线程同时 push，只允许一个线程 pop（反应堆模型所属线程）
+ * @description: 节点直接内嵌在预先申请的环形数组中，每个节点带有一个序号，生产者通过 CAS 抢占写位置，push/pop 过程中不加锁也不申请内存
+ * @description: 序号等于写位置时节点可写，等于写位置 + 1 时节点可读，消费者读取后将序号推进一圈，交还给生产者
+ * @description: 写位置前后用填充数组隔开一个缓存行，不使用 alignas：队列内嵌在 EventLoop 中，C++11 的 new 不保证超出默认值的对齐
+ */
+template <typename T>
+class MpscQueue {
+private:
+	struct Cell {
+		std::atomic<size_t> sequence;  // 节点序号
+		T data;  // 节点数据
+	};
+
+	static const size_t m_cache_line = 64;  // 缓存行大小
+
+	Cell* m_buffer;  // 环形数组
+	size_t m_mask;  // 容量 - 1，容量必须是 2 的幂
+	char m_pad0[m_cache_line];
+	std::atomic<size_t> m_enqueue_pos;  // 写位置，生产者共享，前后的填充保证不与其他成员共享缓存行
+	char m_pad1[m_cache_line - sizeof(std::atomic<size_t>)];
+	size_t m_dequeue_pos;  // 读位置，只有消费者访问
+
+public:
+	MpscQueue(size_t capacity);
+	~MpscQueue();
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	bool push(T&& data);  // 添加数据，队列已满返回 false
+	bool pop(T& data);  // 取出数据，队列为空返回 false（只能由消费者调用）
+	bool empty();  // 判断队列是否为空（只能由消费者调用）
+};
+
+
+/**
+ * @param {size_t} capacity: 队列容量，会向上取整为 2 的幂
+ */
+template <typename T>
+MpscQueue<T>::MpscQueue(size_t capacity) {
+	size_t size = 2;
+	while (size < capacity) {
+		size <<= 1;
+	}
+	m_buffer = new Cell[size];
+	m_mask = size - 1;
+	for (size_t i = 0; i < size; ++i) {
+		m_buffer[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	m_enqueue_pos.store(0, std::memory_order_relaxed);
+	m_dequeue_pos = 0;
+}
+
+template <typename T>
+MpscQueue<T>::~MpscQueue() {
+	delete[] m_buffer;
+}
+
+/**
+ * @description: 添加数据，可以由任意线程调用
+ * @param {T&&} data: 待添加的数据
+ * @return {bool} 成功返回 true；队列已满返回 false
+ */
+template <typename T>
+bool MpscQueue<T>::push(T&& data) {
+	Cell* cell;
+	size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+	while (true) {
+		cell = &m_buffer[pos & m_mask];
+		size_t seq = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+		if (diff == 0) {  // 节点可写，抢占该位置
+			if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (diff < 0) {  // 节点尚未被消费者读取，队列已满
+			return false;
+		}
+		else {  // 该位置已被其他生产者抢占
+			pos = m_enqueue_pos.load(std::memory_order_relaxed);
+		}
+	}
+	cell->data = std::move(data);
+	cell->sequence.store(pos + 1, std::memory_order_release);  // 发布数据
+	return true;
+}
+
+/**
+ * @description: 取出数据，只能由消费者线程调用
+ * @param {T&} data: 传出参数，取出的数据
+ * @return {bool} 成功返回 true；队列为空返回 false
+ */
+template <typename T>
+bool MpscQueue<T>::pop(T& data) {
+	Cell* cell = &m_buffer[m_dequeue_pos & m_mask];
+	size_t seq = cell->sequence.load(std::memory_order_acquire);
+	if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(m_dequeue_pos + 1) < 0) {  // 数据尚未发布
+		return false;
+	}
+	data = std::move(cell->data);
+	cell->sequence.store(m_dequeue_pos + m_mask + 1, std::memory_order_release);  // 交还给生产者
+	++m_dequeue_pos;
+	return true;
+}
+
+/**
+ * @description: 判断队列是否为空，只能由消费者线程调用
+ * @return {bool} 为空返回 true
+ */
+template <typename T>
+bool MpscQueue<T>::empty() {
+	Cell* cell = &m_buffer[m_dequeue_pos & m_mask];
+	size_t seq = cell->sequence.load(std::memory_order_acquire);
+	return static_cast<intptr_t>(seq) - static_cast<intptr_t>(m_dequeue_pos + 1) < 0;
+}
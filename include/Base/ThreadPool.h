@@ -12,6 +12,19 @@
 #include "EventLoop.h"
 #include "WokerThread.h"
 #include <vector>
+#include <stdint.h>
+#include <netinet/in.h>
+
+/** 
+ * @description: 子线程选择策略
+ */
+enum class SelectPolicy:char {
+	ROUNDROBIN,  // 轮询
+	LEASTCONNECTION,  // 连接数量最少
+	POWEROFTWO,  // 随机选择两个，取负载评分较低的一个
+	IPHASH,  // 根据客户端 IP 哈希，同一客户端总是分配给同一子线程
+	INCOMINGCPU  // 根据套接字的 SO_INCOMING_CPU，分配给绑定在接收该连接数据包的 CPU 上的子线程
+};
 
 /** 
  * @description: 线程池类，主要管理主反应堆模型以及子线程
@@ -23,12 +36,44 @@ private:
 	int m_thread_num;  // 线程池数量
 	std::vector<WorkerThread*> m_worker_threads;  // 线程数组
 	int m_index;
+	SelectPolicy m_policy;  // 子线程选择策略
+	uint32_t m_random;  // 随机数状态，只在主线程中使用
+	std::vector<int> m_worker_cpus;  // 子线程绑定的 CPU 编号，第 i 个子线程绑定第 i 个，未指定的不绑定
+
+private:
+	int nextRandom();  // 生成随机数（xorshift）
+	int selectWorker(const struct sockaddr_in* addr, int cfd);  // 根据选择策略选出子线程下标
+	int selectByIncomingCpu(int cfd);  // 选出绑定在接收该连接数据包的 CPU 上的子线程下标
 
 public:
 	ThreadPool(EventLoop* main_loop, int count);
 	~ThreadPool();
 
 	void run();
-	// 取出线程池中的某个子线程的反应堆实例
-	EventLoop* takeWorkerEventLoop();
+	EventLoop* addWorker();  // 添加一个子线程，返回其反应堆实例
+	WorkerThread* removeWorker();  // 从线程池中移除最后一个子线程，由调用者停止并释放
+	// 取出线程池中的某个子线程的反应堆实例，addr 为客户端地址（IPHASH 策略使用），cfd 为通信文件描述符（INCOMINGCPU 策略使用）
+	EventLoop* takeWorkerEventLoop(const struct sockaddr_in* addr = nullptr, int cfd = -1);
+
+	inline void setSelectPolicy(SelectPolicy policy);  // 设置子线程选择策略
+	inline void setWorkerCpus(const std::vector<int>& cpus);  // 设置子线程绑定的 CPU，需要在 run 之前调用
+
+	inline int getThreadNum();  // 获取子线程数量
+	inline EventLoop* getWorkerEventLoop(int index);  // 获取指定子线程的反应堆实例
 };
+
+inline void ThreadPool::setSelectPolicy(SelectPolicy policy) {
+	m_policy = policy;
+}
+
+inline void ThreadPool::setWorkerCpus(const std::vector<int>& cpus) {
+	m_worker_cpus = cpus;
+}
+
+inline int ThreadPool::getThreadNum() {
+	return m_thread_num;
+}
+
+inline EventLoop* ThreadPool::getWorkerEventLoop(int index) {
+	return m_worker_threads[index]->getEventLoop();
+}
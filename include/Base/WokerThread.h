@@ -26,16 +26,19 @@ private:
 	std::mutex m_mutex;  // 互斥锁
 	std::condition_variable m_cond;  // 条件变量
 	EventLoop* m_event_loop;  // 反应堆模型
+	int m_cpu;  // 绑定的 CPU 编号，小于 0 表示不绑定
+	DispatcherType m_dispatcher_type;  // 反应堆模型的底层实现
 
 private:
 	void running();
 
 public:
 	WorkerThread() = delete;
-	WorkerThread(int index);
-	~WorkerThread();
+	WorkerThread(int index, int cpu = -1, DispatcherType type = DispatcherType::EPOLL);
+	~WorkerThread();  // 停止并回收子线程
 
 	void run();  // 启动子线程
+	void stop();  // 退出反应堆模型并等待子线程结束
 	inline EventLoop* getEventLoop();  // 获取子线程的反应堆模型
 };
 
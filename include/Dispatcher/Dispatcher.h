@@ -11,30 +11,23 @@
 #pragma once
 #include <string>
 #include "Channel.h"
-
-class EventLoop;  // 声明，表示该类存在
+#include "EventLoop.h"
 
 /** 
- * @description: Dispatcher 是抽象类，派生出 EpollDispatcher、PollDispatcher、SelectDispatcher 三个子类
- * @description: 调用时统一由 Dispatcher 指针操作，虽然三个子类具体操作不同，但是操作的结果是统一的
+ * @description: Dispatcher 是抽象类，派生出 EpollDispatcher、PollDispatcher、SelectDispatcher、IoUringDispatcher 四个子类
+ * @description: 调用时统一由 Dispatcher 指针操作，虽然四个子类具体操作不同，但是操作的结果是统一的
+ * @description: 子类都声明为 final，EventLoop 在编译期指定具体子类（REACTOR_BACKEND）时，通过子类指针的调用不再经过虚函数表
  */
 class Dispatcher {
 protected:
-	Channel* m_channel;
 	EventLoop* m_event_loop;
 	std::string m_name = std::string();
 public:
 	Dispatcher(EventLoop* event_loop);
 	virtual ~Dispatcher() = default;  // 关闭 fd 或者释放内存
 
-	virtual int add() = 0;  // 添加
-	virtual int remove() = 0;  // 删除
-	virtual int modify() = 0;  // 修改
-	virtual int dispatch(int timeout = 2) = 0;  // 事件检测 timeout: 单位 s
-
-	inline void setChannel(Channel* channel);
-};
-
-inline void Dispatcher::setChannel(Channel* channel) {
-	m_channel = channel;
-}
\ No newline at end of file
+	virtual int add(Channel* channel) = 0;  // 添加
+	virtual int remove(Channel* channel) = 0;  // 删除（只从检测集合中移除，由 EventLoop 调用 destroyCallback 释放资源）
+	virtual int modify(Channel* channel) = 0;  // 修改
+	virtual int dispatch(int timeout = 2000) = 0;  // 事件检测 timeout: 单位 ms
+};
\ No newline at end of file
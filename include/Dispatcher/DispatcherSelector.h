@@ -0,0 +1,51 @@
+/** 
+ * @author: yuyuyuj1e 807152541@qq.com
+ * @github: https://github.com/yuyuyuj1e
+ * @csdn: https://blog.csdn.net/yuyuyuj1e
+ * @date: 2023-03-25 16:42:03
+ * @last_edit_time: 2023-03-25 16:42:03
+ * @file_path: /CC/include/Dispatcher/DispatcherSelector.h
+ * @description: 分发器选择模块头文件
+ */
+
+#pragma once
+#include <string>
+#include "EventLoop.h"
+
+/** 
+ * @description: 负责在运行时选择分发器：解析命令行或配置中的名称，以及 AUTO 模式下的启动自检
+ * @description: 自检在当前线程中为每个可用的实现创建一个临时反应堆模型，注册 expected_fds 个 socketpair 的读端，
+ * @description: 每轮向其中一部分写入数据并处理到全部读完，取总耗时最短的实现，结果与内核版本以及连接规模相关
+ */
+class DispatcherSelector {
+private:
+	static int64_t measure(DispatcherType type, int pairs);  // 测试指定实现，返回耗时（微秒），失败返回 -1
+
+public:
+	static DispatcherType parse(const std::string& name);  // 根据名称获取分发器类型，无法识别时返回 EPOLL
+	static std::string name(DispatcherType type);  // 获取分发器类型的名称
+	static DispatcherType calibrate(int expected_fds = 256);  // 在本机回环上测试各个实现，返回最快的一个
+
+	template <typename Backend>
+	static DispatcherType typeOf();  // 编译期指定的实现对应的类型
+};
+
+template <typename Backend>
+DispatcherType DispatcherSelector::typeOf() {
+	return DispatcherType::EPOLL;
+}
+
+template <>
+inline DispatcherType DispatcherSelector::typeOf<PollDispatcher>() {
+	return DispatcherType::POLL;
+}
+
+template <>
+inline DispatcherType DispatcherSelector::typeOf<SelectDispatcher>() {
+	return DispatcherType::SELECT;
+}
+
+template <>
+inline DispatcherType DispatcherSelector::typeOf<IoUringDispatcher>() {
+	return DispatcherType::IOURING;
+}
@@ -22,21 +22,21 @@
  * @description: 当多路复用的文件数量庞大、IO流量多的时候，通常使用 epoll
  * @description: epoll 只能在 Linux 平台下使用
  */
-class EpollDispatcher : public Dispatcher {
+class EpollDispatcher final : public Dispatcher {
 private:
 	const int m_max_node = 1024;  // epoll_event 数量
 	int m_epfd;  // 文件描述符，可以访问 epoll 实例
 	struct epoll_event* m_events;  // epoll 事件，用来修饰文件描述符，指定检测该未见描述符的什么事件
 
 private:
-	int epollCtl(int op);
+	int epollCtl(Channel* channel, int op);
 
 public:
 	EpollDispatcher(EventLoop* event_loop);
 	~EpollDispatcher();  // 关闭 fd 或者释放内存
 
-	int add() override;  // 添加
-	int remove() override;  // 删除
-	int modify() override;  // 修改
-	int dispatch(int timeout = 2) override;  // 事件检测 timeout: 单位 s
+	int add(Channel* channel) override;  // 添加
+	int remove(Channel* channel) override;  // 删除
+	int modify(Channel* channel) override;  // 修改
+	int dispatch(int timeout = 2000) override;  // 事件检测 timeout: 单位 ms
 };
\ No newline at end of file
@@ -0,0 +1,81 @@
+/** 
+ * @author: yuyuyuj1e 807152541@qq.com
+ * @github: https://github.com/yuyuyuj1e
+ * @csdn: https://blog.csdn.net/yuyuyuj1e
+ * @date: 2023-03-20 10:12:41
+ * @last_edit_time: 2023-03-20 10:12:41
+ * @file_path: /CC/include/Dispatcher/IoUringDispatcher.h
+ * @description: IoUringDispatcher 头文件
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include "Channel.h"
+#include "EventLoop.h"
+#include "Dispatcher.h"
+
+/**
+ * @description: 继承自抽象类 Dispatcher，底层通信模型为 io_uring
+ * @description: 边沿触发的文件描述符对应一个 multishot poll 请求，请求提交一次后会持续产生完成事件，无需每次重新注册
+ * @description: multishot poll 会合并多次唤醒，语义上等同于边沿触发，因此水平触发的文件描述符使用单次 poll，每次完成后在下一次提交时重新注册
+ * @description: add/remove/modify 只是往提交队列中写入请求，统一在 dispatch 中通过一次 io_uring_enter 提交并等待完成事件，从而批量处理多个套接字
+ * @description: io_uring 需要 Linux 5.13 及以上内核（multishot poll），只能在 Linux 平台下使用
+ */
+class IoUringDispatcher final : public Dispatcher {
+private:
+	// 每个文件描述符对应的 poll 请求状态
+	struct PollState {
+		unsigned int generation = 0;  // 请求代数，区分同一个 fd 先后注册的请求，丢弃过期的完成事件
+		unsigned int mask = 0;  // 当前检测的 poll 事件，0 表示没有注册
+		bool multishot = false;  // 是否为 multishot 请求
+	};
+
+	const unsigned int m_max_node = 1024;  // 提交队列长度
+	int m_ring_fd;  // io_uring 实例的文件描述符
+
+	// 提交队列（SQ）
+	void* m_sq_ptr;  // 提交队列映射的内存
+	size_t m_sq_size;  // 提交队列映射的内存大小
+	unsigned int* m_sq_head;
+	unsigned int* m_sq_tail;
+	unsigned int* m_sq_mask;
+	unsigned int* m_sq_array;
+	struct io_uring_sqe* m_sqes;  // 提交队列项数组
+	size_t m_sqes_size;
+	unsigned int m_to_submit;  // 已写入但尚未提交的请求数量
+
+	// 完成队列（CQ）
+	void* m_cq_ptr;  // 完成队列映射的内存（SINGLE_MMAP 时与提交队列相同）
+	size_t m_cq_size;
+	unsigned int* m_cq_head;
+	unsigned int* m_cq_tail;
+	unsigned int* m_cq_mask;
+	struct io_uring_cqe* m_cqes;
+
+	std::vector<PollState> m_polls;  // 以文件描述符为下标的 poll 请求状态
+	std::vector<int> m_retry;  // 提交队列已满而没能提交 poll 请求的文件描述符
+	std::vector<unsigned long long> m_retry_remove;  // 提交队列已满而没能提交的撤销请求（被撤销请求的 user_data）
+	struct __kernel_timespec m_timeout;  // dispatch 的超时时间
+
+private:
+	struct io_uring_sqe* getSqe();  // 获取一个空闲的提交队列项
+	int submit(unsigned int wait_nr);  // 提交请求并等待 wait_nr 个完成事件
+	unsigned int pollMask(Channel* channel);  // 根据 channel 检测的事件计算 poll 事件
+	void pollAdd(int fd, unsigned int mask, bool multishot);  // 提交 poll 请求
+	void pollRemove(int fd);  // 撤销 fd 对应的 poll 请求
+	void pollCancel(unsigned long long data);  // 写入撤销 user_data 为 data 的 poll 请求的提交队列项
+
+public:
+	IoUringDispatcher(EventLoop* event_loop);
+	~IoUringDispatcher();  // 关闭 fd 或者释放内存
+
+	int add(Channel* channel) override;  // 添加
+	int remove(Channel* channel) override;  // 删除
+	int modify(Channel* channel) override;  // 修改
+	int dispatch(int timeout = 2000) override;  // 事件检测 timeout: 单位 ms
+
+	static bool isSupported();  // 判断当前内核（以及容器的安全策略）是否允许使用 io_uring
+};
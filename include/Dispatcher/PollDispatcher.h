@@ -10,6 +10,7 @@
 
 #pragma once
 #include <string>
+#include <vector>
 #include <sys/poll.h>
 #include "Channel.h"
 #include "EventLoop.h"
@@ -18,21 +19,26 @@
 /** 
  * @description: 继承自抽象类 Dispatcher，底层通信模型为 poll 
  * @description: poll 检测以线性方式进行，由于会频繁在用户区和内核区进行拷贝，其开销会随着文件描述符数量的增加而增大
- * @description: poll 没有最大文件描述符数量限制
+ * @description: poll 没有最大文件描述符数量限制，pollfd 数组按需扩容
+ * @description: pollfd 数组始终保持紧凑，删除时将最后一个元素移到空位，并通过以文件描述符为下标的索引表 O(1) 找到对应位置
  * @description: poll 只能在 Linux 平台使用
  */
-class PollDispatcher : public Dispatcher {
+class PollDispatcher final : public Dispatcher {
 private:
-	int m_max_fd_sub;  // 最大有效文件描述复下标
-	struct pollfd* m_fds;  // 每个委托 poll 检测的 fd 都对应一个 pollfd 结构体
-	const int m_max_node = 1024;  //  检测数量
+	std::vector<struct pollfd> m_fds;  // 每个委托 poll 检测的 fd 都对应一个 pollfd 结构体，没有空位
+	std::vector<int> m_slots;  // 以文件描述符为下标，记录其在 m_fds 中的位置，-1 表示不在检测集合中
+	std::vector<struct pollfd> m_ready;  // 本次就绪的文件描述符，处理事件时 m_fds 可能被修改，因此先复制出来
+
+private:
+	short pollEvents(Channel* channel);  // 根据 channel 检测的事件计算 poll 事件
+	int findSlot(int fd);  // 查找文件描述符在 m_fds 中的位置
 
 public:
 	PollDispatcher(EventLoop* evLoop);
 	~PollDispatcher();  // 关闭 fd 或者释放内存
 
-	int add() override;  // 添加
-	int remove() override;  // 删除
-	int modify() override;  // 修改
-	int dispatch(int timeout = 2) override;  // 事件检测 timeout: 单位 s
+	int add(Channel* channel) override;  // 添加
+	int remove(Channel* channel) override;  // 删除
+	int modify(Channel* channel) override;  // 修改
+	int dispatch(int timeout = 2000) override;  // 事件检测 timeout: 单位 ms
 };
\ No newline at end of file
@@ -21,22 +21,22 @@
  * @description: select 检测上限是 1024，及时超过上限内核也会强制设置为 1024
  * @description: select 可以跨平台使用
  */
-class SelectDispatcher : public Dispatcher {
+class SelectDispatcher final : public Dispatcher {
 private:
 	fd_set m_read_set;  // 文件描述符集合，只检测该集合中的读缓冲区，传入传出参数
 	fd_set m_write_set;  // 文件描述符集合，只检测该集合中的写缓冲区，传入传出参数
 	const int m_max_size = 1024;  // 最多可检测文件描述符的数量
 
 private:
-	void setFdSet();  // 添加文件描述符
-	void clearFdSet();  // 移除文件描述符
+	void setFdSet(Channel* channel);  // 添加文件描述符
+	void clearFdSet(Channel* channel);  // 移除文件描述符
 
 public:
 	SelectDispatcher(EventLoop* evLoop);
 	~SelectDispatcher() = default;  // 关闭 fd 或者释放内存
 
-	int add() override;  // 添加
-	int remove() override;  // 删除
-	int modify() override;  // 修改
-	int dispatch(int timeout = 2) override;  // 事件检测 timeout: 单位 s
+	int add(Channel* channel) override;  // 添加
+	int remove(Channel* channel) override;  // 删除
+	int modify(Channel* channel) override;  // 修改
+	int dispatch(int timeout = 2000) override;  // 事件检测 timeout: 单位 ms
 };
\ No newline at end of file
@@ -24,6 +24,15 @@ enum class PrecessState :char {
     DONE
 };
 
+/** 
+ * @description: 解析结果，数据不完整时返回 AGAIN，解析状态保存在 HttpRequest 中，收到更多数据后从中断的位置继续
+ */
+enum class ParseResult :char {
+    COMPLETE,  // 当前阶段（或者整个请求）解析完成
+    AGAIN,  // 数据不完整，需要等待更多数据
+    ERROR  // 请求格式错误或者超出长度限制
+};
+
 
 /** 
  * @description: 用于解析 HTTP 请求头
@@ -36,26 +45,34 @@ private:
     std::map<std::string, std::string> m_reqquest_headers;  // 请求头信息
     std::map<std::string, std::string> m_reqquest_body;  // 请求体信息
     PrecessState m_cur_state;  // 请求头当前状态
+    int m_scan_offset;  // 当前行已经查找过 \r\n 的字节数，收到更多数据后从这里继续查找，不重复扫描
+    int m_header_size;  // 已经解析的请求头总长度
+    int m_content_length;  // 请求体长度
+    static const int m_max_line_size = 8 * 1024;  // 请求行或者单个请求头的最大长度
+    static const int m_max_header_size = 32 * 1024;  // 请求头的最大总长度
+    static const int m_max_body_size = 1024 * 1024;  // 请求体的最大长度
 
 private:
     void reset();  // 重置对象(当一个请求头处理完毕后调用)
 
+    char* findLineEnd(Buffer* read_buffer);  // 从上次查找结束的位置继续查找 \r\n
     char* splitLine(const char* start, const char* end, const char* sub, std::function<void(std::string)> callback);  // 拆分请求行
-    bool parseLine(Buffer* read_buffer);  // 解析请求行
+    ParseResult parseLine(Buffer* read_buffer);  // 解析请求行
 
     bool addHeader(const std::string key, const std::string value, std::map<std::string, std::string>* map);  // 添加请求头
     std::string getHeader(const std::string key, std::map<std::string, std::string>* map);  // 根据key得到请求头的value
-    bool parseHeader(Buffer* read_buffer);  // 解析请求头
+    ParseResult parseHeader(Buffer* read_buffer);  // 解析请求头
+    ParseResult endHeaders();  // 请求头解析完毕，确定请求体长度
 
     bool splitBody(char* start, int line_size);  // 拆分请求体
-    bool parseBody(Buffer* read_buffer);  // 解析请求体
+    ParseResult parseBody(Buffer* read_buffer);  // 解析请求体
 
     int hexToDec(char c);  // 将十六进制字符转换为整形数
     std::string decodeMsg(std::string from);  // 解码字符串
     bool processRequest(HttpResponse* response);  // 处理http请求协议
     const std::string getFileType(const std::string name);
-    static bool sendDir(std::string dir_name, Buffer* send_buffer, int cfd);
-    static bool sendFile(std::string dir_name, Buffer* send_buffer, int cfd);
+    static std::string buildDir(std::string dir_name);
+    static int openFile(std::string file_name);
     
     inline void setMethod(std::string method);
     inline void setUrl(std::string url);
@@ -68,7 +85,7 @@ public:
     ~HttpRequest() = default;
     
     // 解析http请求协议
-    bool parseRequest(Buffer* read_buffer, HttpResponse* response, Buffer* send_buffer, int socket);  
+    ParseResult parseRequest(Buffer* read_buffer, HttpResponse* response, Buffer* send_buffer);  
 };
 
 
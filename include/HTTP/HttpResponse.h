@@ -43,18 +43,31 @@ private:
 	std::string m_file_name;  // 响应文件
 	std::map<std::string, std::string> m_headers;  // 响应头 —— 键值对
 
-	std::function<void(std::string, Buffer*, int)> sendDataFunc;
+	int m_body_fd;  // 响应体文件，由 TcpConnection 按预算分批读取并发送，-1 表示没有
+	std::function<std::string(std::string)> m_build_func;  // 生成响应体的函数，纯计算，可以在计算线程池中执行
+	bool m_keep_alive;  // 发送完毕后是否保持连接，决定响应头 Connection 的值
+	bool m_head_only;  // 是否只回复响应头（HEAD 请求）
 
 public:
 	HttpResponse();
-	~HttpResponse() = default;
+	~HttpResponse();  // 关闭尚未交给 TcpConnection 的响应体文件
 
+	void reset();  // 重置对象，长连接处理下一个请求之前调用
 	void addHeader(const std::string key, const std::string value);  // 添加响应头
-	void prepareHeadMsg(Buffer* send_buffer, int socket);  // 组织 http 响应头数据
+	void prepareHeadMsg(Buffer* send_buffer);  // 组织 http 响应头数据
 	
 	inline void setFileName(std::string name);
 	inline void setStatusCode(StatusCode code);
-	inline void setFunc(std::function<void(std::string, Buffer*, int)> func);
+	inline void setBodyFd(int fd);
+	inline int takeBodyFd();  // 取出响应体文件，之后由调用者负责关闭
+	inline void setBuildFunc(std::function<std::string(std::string)> func);
+	inline bool isBodyPending();  // 响应体是否还需要通过 m_build_func 生成
+	inline std::function<std::string(std::string)> getBuildFunc();
+	inline std::string getFileName();
+	inline void setKeepAlive(bool flag);
+	inline bool isKeepAlive();
+	inline void setHeadOnly(bool flag);
+	inline bool isHeadOnly();
 };
 
 inline void HttpResponse::setFileName(std::string name) { 
@@ -65,6 +78,44 @@ inline void HttpResponse::setStatusCode(StatusCode code) {
 	m_status_code = code; 
 }
 
-inline void HttpResponse::setFunc(std::function<void(std::string, Buffer*, int)> func) {
-	sendDataFunc = func;
+inline void HttpResponse::setBodyFd(int fd) {
+	m_body_fd = fd;
+}
+
+inline int HttpResponse::takeBodyFd() {
+	int fd = m_body_fd;
+	m_body_fd = -1;
+	return fd;
+}
+
+inline void HttpResponse::setBuildFunc(std::function<std::string(std::string)> func) {
+	m_build_func = func;
+}
+
+inline bool HttpResponse::isBodyPending() {
+	return m_build_func != nullptr;
+}
+
+inline std::function<std::string(std::string)> HttpResponse::getBuildFunc() {
+	return m_build_func;
+}
+
+inline std::string HttpResponse::getFileName() {
+	return m_file_name;
+}
+
+inline void HttpResponse::setKeepAlive(bool flag) {
+	m_keep_alive = flag;
+}
+
+inline bool HttpResponse::isKeepAlive() {
+	return m_keep_alive;
+}
+
+inline void HttpResponse::setHeadOnly(bool flag) {
+	m_head_only = flag;
+}
+
+inline bool HttpResponse::isHeadOnly() {
+	return m_head_only;
 }
\ No newline at end of file
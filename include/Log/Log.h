@@ -69,7 +69,7 @@ public:
     
     static void addTaskStatic(std::string str, int flag, void* arg);  // 向任务队列添加任务
     void addTask(std::string str, int flag = 1);  // 向任务队列添加任务
-    void run();  // 日志类启动函数
+    void run(int cpu = -1);  // 日志类启动函数，cpu 为日志线程绑定的 CPU，小于 0 表示不绑定
 
     inline static Log* getInstance();  // 获取日志实例
 };
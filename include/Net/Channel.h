@@ -9,13 +9,14 @@
  */
 
 #pragma once
-#include <functional>
 
 // 定义文件描述符的读写事件
 enum class FDEvent : char {
 	TIMEOUT = 1 << 0,
 	READEVENT = 1 << 1,
-	WRITEEVENT = 1 << 2
+	WRITEEVENT = 1 << 2,
+	EDGETRIGGER = 1 << 3,  // 边沿触发（仅 epoll 生效），需要配合非阻塞套接字使用
+	ONESHOT = 1 << 4  // 单次触发，由领导者/跟随者模式共享的 epoll 实例检测，处理完毕后需要重新注册
 };
 
 /** 
@@ -28,14 +29,20 @@ private:
 	void* m_arg;  // 回调函数的参数
 
 public:
-	// 可调用对象包装器可打包 1. 函数指针 2. 可调用对象（可以像函数一样使用），最后得到的是地址
+	// 回调使用普通函数指针（类静态函数），状态统一通过 m_arg 传入
+	// 相比 std::function 不需要类型擦除，也不会为捕获的对象申请堆内存，创建 channel 只需要一次固定大小的内存申请，回调为直接的间接调用
 	// using handleFunc = int(*)(void*) <==> typedef int(*handleFunc)(void* arg)
-	using handleFunc = std::function<int(void*)>;
+	using handleFunc = int(*)(void*);
 	Channel(int fd, FDEvent events, handleFunc readFunc, handleFunc writeFunc, handleFunc destroyFunc, void* arg);
 	~Channel() = default;
 	
+	void readEventEnable(bool flag);  // 修改 fd 的读事件（检测 or 不检测）
 	void writeEventEnable(bool flag);  // 修改 fd 的写事件（检测 or 不检测）
 	bool isWriteEventEnable();  // 判断是否需要检测文件描述符的写事件
+	void edgeTriggerEnable(bool flag);  // 修改 fd 的触发方式（边沿触发 or 水平触发）
+	bool isEdgeTrigger();  // 判断文件描述符是否为边沿触发
+	void oneShotEnable(bool flag);  // 修改 fd 是否单次触发
+	bool isOneShot();  // 判断文件描述符是否为单次触发
 
 	// 取出私有成员的值
 	inline int getEvent();
@@ -10,24 +10,100 @@
 
 #pragma once
 #include "Channel.h"
+#include "MpscQueue.h"
+#include "TimerWheel.h"
 #include <thread>
-#include <queue>
-#include <map>
+#include <atomic>
 #include <mutex>
+#include <string>
+#include <vector>
+#include <functional>
 
-class Dispatcher;  // 声明
+// 声明
+class Dispatcher;
+class EpollDispatcher;
+class PollDispatcher;
+class SelectDispatcher;
+class IoUringDispatcher;
+class LeaderFollower;
+
+// 编译期选择反应堆模型的底层实现（CMake 选项 REACTOR_BACKEND），默认通过 Dispatcher 指针在运行时多态调用
+#if defined(REACTOR_BACKEND_EPOLL)
+using ReactorBackend = EpollDispatcher;
+#elif defined(REACTOR_BACKEND_POLL)
+using ReactorBackend = PollDispatcher;
+#elif defined(REACTOR_BACKEND_SELECT)
+using ReactorBackend = SelectDispatcher;
+#elif defined(REACTOR_BACKEND_IOURING)
+using ReactorBackend = IoUringDispatcher;
+#else
+using ReactorBackend = Dispatcher;
+#endif
+
+// 运行时选择的底层实现，仅在 ReactorBackend 为 Dispatcher 时生效
+enum class DispatcherType:char {
+	EPOLL,
+	POLL,
+	SELECT,
+	IOURING,
+	AUTO  // 启动时在本机回环上测试各个可用的实现，选择最快的一个
+};
 
 // 处理节点中的 channel 的方式
 enum class ElemType:char {
 	ADD,
 	DELETE,
-	MODIFY
+	MODIFY,
+	FUNCTOR,  // 在反应堆模型所属线程中执行任意任务
+	CALLBACK,  // 在反应堆模型所属线程中调用普通函数指针，参数按值存放在节点中
+	TIMER  // 由其他线程添加的定时器，在所属线程中加入时间轮
 };
 
-// 定义任务队列的节点
+// 忙轮询统计，用于调整自旋预算
+struct BusyPollStats {
+	uint64_t spin_us;  // 空转（非阻塞检测没有就绪事件）的时间（微秒）
+	uint64_t work_us;  // 自旋期间检测到事件并处理的时间（微秒）
+	uint64_t spin_hits;  // 自旋期间检测到事件的次数，每次相当于省去一次阻塞与唤醒
+	uint64_t blocks;  // 预算用完后退回阻塞等待的次数
+};
+
+// 事件循环当前所处的阶段，由看门狗读取，用于定位阻塞的代码路径
+enum class LoopStage:char {
+	IDLE,  // 阻塞在 dispatch 中等待事件
+	READ,  // 执行 channel 的读回调
+	WRITE,  // 执行 channel 的写回调
+	TIMER,  // 执行到期的定时器
+	TASK  // 处理任务队列
+};
+
+// 事件循环的心跳快照，看门狗线程通过 getHeartbeat 获取
+struct LoopHeartbeat {
+	uint64_t iterations;  // 已经完成的轮数
+	int64_t iteration_start;  // 本轮开始处理的时间（微秒），0 表示正在等待事件
+	int64_t iteration_end;  // 上一轮结束的时间（微秒）
+	LoopStage stage;  // 当前阶段
+	int fd;  // 正在执行回调的文件描述符，-1 表示不在 channel 回调中
+	std::string label;  // 该文件描述符对应连接发布的描述（请求行），没有时为空
+};
+
+template <typename Backend>
+class BasicEventLoop;
+using EventLoop = BasicEventLoop<ReactorBackend>;
+
+// CALLBACK 任务调用的函数，与 Channel 的回调一样使用普通函数指针，状态通过 arg 与 fd 传入
+using TaskFunc = void(*)(EventLoop* event_loop, void* arg, int fd);
+
+// 定义任务队列的节点，节点按值存放在任务队列中，添加任务时不需要申请内存
 struct ChannelElement {
 	ElemType type;  // 如何处理节点中的 channel
 	Channel* channel;
+	TaskFunc func = nullptr;  // type 为 CALLBACK 时调用的函数
+	void* arg = nullptr;  // func 的参数
+	int fd = -1;  // func 的参数
+	TimerId timer = 0;  // type 为 TIMER 时的定时器编号
+	int64_t delay = 0;  // type 为 TIMER 时的延迟时间（毫秒）
+	int64_t interval = 0;  // type 为 TIMER 时的重复间隔（毫秒），0 表示只执行一次
+	std::function<void()> functor;  // type 为 FUNCTOR 时执行的任务，TIMER 时的到期回调
 };
 
 
@@ -36,50 +112,339 @@ struct ChannelElement {
  * @description: 由主线程控制的主事件循环模型（主反应堆模型）主要负责，监听连接请求，与客户端建立连接，并将随后通信任务交给子线程
  * @description: 由子线程控制的子反应堆模型，主要负责与客户端的通信，在断开连接时需要处理关闭连接的操作
  * @description: 一个反应堆模型可以与多个客户端进行通信，每次需要通过 m_taskQ 取出一个需要操作的 Channel 对象，该对象封装了一个文件描述符
+ * @description: Backend 为底层实现，指定为具体的 Dispatcher 子类时，add/remove/modify/dispatch 直接调用子类函数，不经过虚函数表
+ * @description: 整个程序只使用一种实例化 EventLoop = BasicEventLoop<ReactorBackend>，成员函数定义在源文件中并显式实例化
  */
-class EventLoop {
+template <typename Backend>
+class BasicEventLoop {
 private:
-	// 该指针指向子类的实例 poll epoll select
-	Dispatcher* m_dispatcher;  // 底层实现方式
+	// Backend 为 Dispatcher 时，该指针指向子类的实例 poll epoll select io_uring
+	Backend* m_dispatcher;  // 底层实现方式
+	DispatcherType m_dispatcher_type;  // 实际使用的底层实现
 
-	std::queue<ChannelElement*> m_taskQ;  // 任务队列
-	// std::queue<std::map<ElemTypem, Channel*>> m_taskQ;
-	std::map<int, Channel*> m_channel_map;  // map
+	MpscQueue<ChannelElement> m_taskQ;  // 任务队列，其他线程无锁添加，只有所属线程取出
+	std::vector<Channel*> m_channels;  // 以文件描述符为下标的 channel 表，未使用的位置为 nullptr
 
 	// 线程相关
 	std::thread::id m_threadID;  // 线程 ID
 	std::string m_thread_name;  // 线程名称
-	std::mutex m_mutex;  // 互斥锁
 
-	int m_socket_pair[2];  // 存储本地通信的 fd，通过 socketpair 初始化
+	TimerWheel m_timer_wheel;  // 定时器，决定 dispatch 的超时时间
+	const int m_max_timeout = 2000;  // dispatch 最长阻塞时间（毫秒）
+
+	int m_wakeup_fd;  // 用于线程间通知的 eventfd
+	std::atomic<bool> m_wakeup_pending;  // 是否已经写入了尚未被读取的通知，用于合并唤醒
 	bool m_quit;  // 退出标志
 
+	// 忙轮询，预算为 0 时不自旋，每轮直接阻塞在 dispatch 中
+	std::atomic<int> m_busy_poll_us;  // 自旋预算（微秒），可以由其他线程随时调整
+	std::atomic<uint64_t> m_spin_us;  // 统计数据，只由所属线程写入，其他线程无锁读取
+	std::atomic<uint64_t> m_work_us;
+	std::atomic<uint64_t> m_spin_hits;
+	std::atomic<uint64_t> m_blocks;
+
+	// 工作预算，防止单个连接长时间占用线程
+	std::atomic<int> m_write_budget;  // 每个连接每轮最多发送的字节数
+	std::atomic<int> m_turn_budget_us;  // 每轮处理就绪事件的时间预算（微秒），超出后剩余连接每轮只发送一块，0 表示不限制
+	int64_t m_turn_start;  // 本轮第一个就绪事件的处理时间（微秒），0 表示本轮还没有处理事件
+
+	// 长连接设置，由该反应堆模型上的连接读取
+	std::atomic<int> m_idle_timeout;  // 空闲连接的超时时间（毫秒），0 表示不保持连接
+	std::atomic<int> m_max_requests;  // 每个连接最多处理的请求数量，0 表示不限制
+	std::atomic<uint64_t> m_busy_us;  // 累计处理就绪事件、定时器与任务的时间（微秒），不包括等待时间，用于计算利用率
+
+	// 负载计数，由其他线程（线程池的选择策略）无锁读取
+	std::atomic<int> m_connection_count;  // 分配给该反应堆模型的连接数量
+	std::atomic<int> m_pending_tasks;  // 任务队列中尚未处理的任务数量
+	std::atomic<uint64_t> m_incoming_cpu_hits;  // INCOMINGCPU 策略下，因为绑定在套接字接收数据的 CPU 上而被选中的次数
+	std::atomic<uint64_t> m_incoming_cpu_misses;  // INCOMINGCPU 策略下，没有匹配的子线程时退化为轮询而被选中的次数
+
+	// 心跳与阻塞统计，由所属线程发布，看门狗线程无锁读取
+	static const int m_stall_buckets = 12;  // 第 0 个桶统计 1 毫秒以内，第 i 个桶统计 [2^(i-1), 2^i) 毫秒，最后一个桶统计 1 秒以上
+	std::atomic<uint64_t> m_iterations;  // 已经完成的轮数
+	std::atomic<int64_t> m_iteration_start;  // 本轮开始处理的时间（微秒），0 表示正在等待事件
+	std::atomic<int64_t> m_iteration_end;  // 上一轮结束的时间（微秒）
+	std::atomic<LoopStage> m_stage;  // 当前阶段
+	std::atomic<int> m_current_fd;  // 正在执行回调的文件描述符
+	std::atomic<uint64_t> m_stall_histogram[m_stall_buckets];  // 每轮处理耗时的分布
+	std::atomic<bool> m_watched;  // 是否被看门狗检测，检测时连接才发布描述
+	std::mutex m_probe_mutex;  // 保护连接发布的描述，只在发布新请求与看门狗发现阻塞时加锁
+	int m_probe_fd;  // 最近一次发布描述的文件描述符
+	std::string m_probe_label;  // 最近一次发布的描述
+
+	LeaderFollower* m_leader_follower;  // 领导者/跟随者模式共享的 epoll 实例，单次触发的 channel 由它检测
+
 private:
 	void taskWakeup();  // 唤醒线程处理任务
+	void pushTask(ChannelElement&& task);  // 将任务放入任务队列，队列已满时等待消费者处理
+	void queueTimer(TimerId id, int64_t delay, int64_t interval, std::function<void()>&& functor);  // 将其他线程添加的定时器投递给所属线程
+	int busyPoll();  // 在预算内自旋检测事件，预算用完后阻塞等待
+	void iterationBegin(int64_t now);  // 发布本轮开始处理的时间
+	void iterationEnd(int64_t start, int64_t end);  // 发布本轮结束的时间并记录耗时
 
 public:
-	EventLoop();
-	EventLoop(const std::string thread_name);
-	~EventLoop() = default;
+	// 捕获内容不超过两个指针大小且可平凡复制的 lambda 存放在 std::function 内部，投递时不会申请堆内存
+	// 捕获更多内容或者捕获 shared_ptr 等对象的 lambda（如计算线程池交还结果、空闲计时器的回调）在构造 std::function 时申请一次堆内存
+	// 热点路径上需要传递更多参数时使用 CALLBACK 任务（函数指针 + arg + fd），如主线程向子线程交付连接
+	using Functor = std::function<void()>;
+
+	BasicEventLoop();
+	BasicEventLoop(const std::string thread_name, DispatcherType type = DispatcherType::EPOLL, int expected_fds = 256);  // expected_fds 仅在 AUTO 自检时使用
+	~BasicEventLoop();
 
 	int run();  // 启动反应堆模型
-	int eventActive(int fd, int event);  // 处理激活的文件描述符
+	void quit();  // 退出反应堆模型（线程安全）
+	int runOnce(int timeout);  // 执行一轮事件检测、定时器与任务处理
+	inline int eventActive(int fd, int event);  // 处理激活的文件描述符
 	int addTask(Channel* channel, ElemType type);  // 添加任务到任务队列
 	int processTaskQ();  // 处理任务队列的任务
+	void runInLoop(Functor functor);  // 在反应堆模型所属线程中执行任务，当前就是所属线程时直接执行
+	void queueInLoop(Functor functor);  // 将任务添加到任务队列，由所属线程在本轮事件处理完毕后执行
+	void queueInLoop(TaskFunc func, void* arg, int fd);  // 同上，任务为普通函数指针，投递时不申请内存
+
+	// 定时器，可以由任意线程调用，回调在所属线程中执行
+	TimerId runAfter(int64_t delay, Functor functor);  // delay 毫秒后执行一次
+	TimerId runEvery(int64_t interval, Functor functor);  // 每隔 interval 毫秒执行一次
+	void cancel(TimerId id);  // 取消定时器
 
 	// 处理 dispatcher 中的节点
 	int add(Channel* channel);
 	int remove(Channel* channel);
 	int modify(Channel* channel);
+	int detach(Channel* channel);  // 摘除但不释放，用于迁移连接
 
 	int freeChannel(Channel* channel);  // 释放 channel
 
 	static int readLocalMessage(void* arg);  // 类静态函数，无需实例化对象也存在
 	
+	inline Channel* findChannel(int fd);  // 根据文件描述符取出 channel
+	inline int getChannelCapacity();  // channel 表的大小，遍历 channel 表时使用
+	inline void prefetchChannel(int fd);  // 预取下一个就绪的 channel
+
 	// 获取成员变量
 	inline std::thread::id getThreadID();
+	inline const std::string& getThreadName();
+	inline DispatcherType getDispatcherType();
+	inline bool isInLoopThread();  // 判断当前线程是否为反应堆模型所属线程
+	inline void setLeaderFollower(LeaderFollower* leader_follower);  // 设置领导者/跟随者模式共享的 epoll 实例
+	inline void setBusyPoll(int budget_us);  // 设置忙轮询的自旋预算（微秒），0 表示关闭
+	inline void setWorkBudget(int write_budget, int turn_budget_us);  // 设置每个连接每轮的发送字节数以及每轮的时间预算
+	inline int getWriteBudget();  // 获取每个连接每轮最多发送的字节数
+	inline bool isTurnOverBudget();  // 判断本轮处理就绪事件的时间是否超出预算，只能由所属线程调用
+	inline void setKeepAlive(int idle_timeout, int max_requests);  // 设置长连接的空闲超时时间（毫秒）与最多请求数量
+	inline int getIdleTimeout();
+	inline int getMaxRequests();
+	BusyPollStats getBusyPollStats();  // 获取忙轮询统计
+
+	// 负载计数
+	inline void connectionAttached();  // 分配了一个连接
+	inline void connectionDetached();  // 释放了一个连接
+	inline int getConnectionCount();
+	inline int getPendingTasks();
+	inline int getLoadScore();  // 负载评分，数值越大负载越高
+	inline uint64_t getBusyTime();  // 累计的忙碌时间（微秒）
+	inline void incomingCpuRouted(bool hit);  // 记录一次按照 SO_INCOMING_CPU 的分配结果
+	inline uint64_t getIncomingCpuHits();  // 选中首选反应堆模型（同一 CPU）的次数
+	inline uint64_t getIncomingCpuMisses();  // 退化为轮询的次数
+
+	// 心跳与阻塞检测
+	inline void setWatched(bool flag);  // 设置是否被看门狗检测
+	inline bool isWatched();
+	void publishProbe(int fd, const std::string& label);  // 连接发布当前请求的描述，只能由所属线程调用
+	LoopHeartbeat getHeartbeat();  // 获取心跳快照，可以由任意线程调用
+	std::vector<uint64_t> getStallHistogram();  // 获取每轮处理耗时的分布，可以由任意线程调用
+	static const std::string& stallBucketName(int index);  // 耗时分布各个桶的名称
 };
 
-inline std::thread::id EventLoop::getThreadID() {
+template <typename Backend>
+inline std::thread::id BasicEventLoop<Backend>::getThreadID() {
 	return m_threadID;
 }
+
+template <typename Backend>
+inline const std::string& BasicEventLoop<Backend>::getThreadName() {
+	return m_thread_name;
+}
+
+template <typename Backend>
+inline void BasicEventLoop<Backend>::setWatched(bool flag) {
+	m_watched.store(flag, std::memory_order_relaxed);
+}
+
+template <typename Backend>
+inline bool BasicEventLoop<Backend>::isWatched() {
+	return m_watched.load(std::memory_order_relaxed);
+}
+
+template <typename Backend>
+inline DispatcherType BasicEventLoop<Backend>::getDispatcherType() {
+	return m_dispatcher_type;
+}
+
+template <typename Backend>
+inline void BasicEventLoop<Backend>::setLeaderFollower(LeaderFollower* leader_follower) {
+	m_leader_follower = leader_follower;
+}
+
+template <typename Backend>
+inline void BasicEventLoop<Backend>::setBusyPoll(int budget_us) {
+	m_busy_poll_us.store(budget_us > 0 ? budget_us : 0, std::memory_order_relaxed);
+}
+
+template <typename Backend>
+inline void BasicEventLoop<Backend>::setWorkBudget(int write_budget, int turn_budget_us) {
+	m_write_budget.store(write_budget > 0 ? write_budget : 1, std::memory_order_relaxed);
+	m_turn_budget_us.store(turn_budget_us > 0 ? turn_budget_us : 0, std::memory_order_relaxed);
+}
+
+template <typename Backend>
+inline int BasicEventLoop<Backend>::getWriteBudget() {
+	return m_write_budget.load(std::memory_order_relaxed);
+}
+
+template <typename Backend>
+inline bool BasicEventLoop<Backend>::isTurnOverBudget() {
+	int budget = m_turn_budget_us.load(std::memory_order_relaxed);
+	return budget > 0 && m_turn_start > 0 && TimerWheel::nowUs() - m_turn_start > budget;
+}
+
+template <typename Backend>
+inline bool BasicEventLoop<Backend>::isInLoopThread() {
+	return m_threadID == std::this_thread::get_id();
+}
+
+template <typename Backend>
+inline void BasicEventLoop<Backend>::connectionAttached() {
+	m_connection_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename Backend>
+inline void BasicEventLoop<Backend>::connectionDetached() {
+	m_connection_count.fetch_sub(1, std::memory_order_relaxed);
+}
+
+template <typename Backend>
+inline int BasicEventLoop<Backend>::getConnectionCount() {
+	return m_connection_count.load(std::memory_order_relaxed);
+}
+
+template <typename Backend>
+inline uint64_t BasicEventLoop<Backend>::getBusyTime() {
+	return m_busy_us.load(std::memory_order_relaxed);
+}
+
+template <typename Backend>
+inline void BasicEventLoop<Backend>::incomingCpuRouted(bool hit) {
+	if (hit) {
+		m_incoming_cpu_hits.fetch_add(1, std::memory_order_relaxed);
+	}
+	else {
+		m_incoming_cpu_misses.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+template <typename Backend>
+inline uint64_t BasicEventLoop<Backend>::getIncomingCpuHits() {
+	return m_incoming_cpu_hits.load(std::memory_order_relaxed);
+}
+
+template <typename Backend>
+inline uint64_t BasicEventLoop<Backend>::getIncomingCpuMisses() {
+	return m_incoming_cpu_misses.load(std::memory_order_relaxed);
+}
+
+template <typename Backend>
+inline int BasicEventLoop<Backend>::getPendingTasks() {
+	return m_pending_tasks.load(std::memory_order_relaxed);
+}
+
+/** 
+ * @description: 负载评分，连接数量反映长期负载，积压的任务数量反映瞬时负载，只是近似值，不需要与所属线程同步
+ * @return {int} 负载评分
+ */
+template <typename Backend>
+inline int BasicEventLoop<Backend>::getLoadScore() {
+	return getConnectionCount() + getPendingTasks();
+}
+
+/** 
+ * @description: 根据文件描述符取出 channel，只需要一次下标访问
+ * @param {int} fd: 文件描述符
+ * @return {Channel*} 对应的 channel，不存在返回 nullptr
+ */
+template <typename Backend>
+inline Channel* BasicEventLoop<Backend>::findChannel(int fd) {
+	if (fd < 0 || fd >= static_cast<int>(m_channels.size())) {
+		return nullptr;
+	}
+	return m_channels[fd];
+}
+
+template <typename Backend>
+inline void BasicEventLoop<Backend>::setKeepAlive(int idle_timeout, int max_requests) {
+	m_idle_timeout.store(idle_timeout > 0 ? idle_timeout : 0, std::memory_order_relaxed);
+	m_max_requests.store(max_requests > 0 ? max_requests : 0, std::memory_order_relaxed);
+}
+
+template <typename Backend>
+inline int BasicEventLoop<Backend>::getIdleTimeout() {
+	return m_idle_timeout.load(std::memory_order_relaxed);
+}
+
+template <typename Backend>
+inline int BasicEventLoop<Backend>::getMaxRequests() {
+	return m_max_requests.load(std::memory_order_relaxed);
+}
+
+template <typename Backend>
+inline int BasicEventLoop<Backend>::getChannelCapacity() {
+	return static_cast<int>(m_channels.size());
+}
+
+/** 
+ * @description: 分发器处理当前就绪事件时，提前将下一个就绪的 channel 加载到缓存中
+ * @param {int} fd: 下一个就绪的文件描述符
+ */
+template <typename Backend>
+inline void BasicEventLoop<Backend>::prefetchChannel(int fd) {
+	Channel* channel = findChannel(fd);
+	if (channel != nullptr) {
+		__builtin_prefetch(channel);
+	}
+}
+
+/** 
+ * @description: 处理文件描述符对应事件，由分发器对每个就绪事件调用，定义在头文件中以便内联
+ * @param {int} fd: 文件描述符（对应其在 channel 表中的下标）
+ * @param {int} event: 处理事件
+ * @return {int} 成功返回 0；失败返回 -1
+ */
+template <typename Backend>
+inline int BasicEventLoop<Backend>::eventActive(int fd, int event) {
+	// 取出 channel
+	Channel* channel = findChannel(fd);  // 通过 fd 找到 channel
+	if (channel == nullptr) {  // 已经被释放
+		return -1;
+	}
+	if (m_turn_start == 0) {  // 本轮的时间预算、忙碌时间与心跳都从第一个就绪事件开始计算
+		m_turn_start = TimerWheel::nowUs();
+		iterationBegin(m_turn_start);
+	}
+	m_current_fd.store(fd, std::memory_order_relaxed);
+
+	// 处理文件描述符对应事件
+	if (event & (int)FDEvent::READEVENT && channel->readCallback != NULL) {
+		m_stage.store(LoopStage::READ, std::memory_order_relaxed);
+		channel->readCallback(const_cast<void*>(channel->getArg()));  // 处理文件描述符的读事件
+		if (findChannel(fd) != channel) {  // 读回调中断开了连接，channel 已被释放
+			m_current_fd.store(-1, std::memory_order_relaxed);
+			return 0;
+		}
+	}
+	if (event & (int)FDEvent::WRITEEVENT && channel->writeCallback != NULL) {
+		m_stage.store(LoopStage::WRITE, std::memory_order_relaxed);
+		channel->writeCallback(const_cast<void*>(channel->getArg()));  // 处理文件描述符的写事件
+	}
+	m_current_fd.store(-1, std::memory_order_relaxed);
+	return 0;
+}
@@ -0,0 +1,50 @@
+/** 
+ * @author: yuyuyuj1e 807152541@qq.com
+ * @github: https://github.com/yuyuyuj1e
+ * @csdn: https://blog.csdn.net/yuyuyuj1e
+ * @date: 2023-03-24 10:18:36
+ * @last_edit_time: 2023-03-24 10:18:36
+ * @file_path: /CC/include/Net/LeaderFollower.h
+ * @description: 领导者/跟随者线程模型头文件
+ */
+
+#pragma once
+#include "Channel.h"
+#include <thread>
+#include <atomic>
+#include <vector>
+
+/** 
+ * @description: 领导者/跟随者线程模型，所有线程共享同一个 epoll 实例，与主从反应堆模型二选一
+ * @description: 空闲线程（跟随者）都阻塞在共享 epoll 实例的 epoll_wait 上，内核每次只唤醒其中一个（领导者），领导者只取出一个就绪事件并处理，其余事件留给其他线程
+ * @description: 文件描述符以 EPOLLONESHOT 注册，触发一次后自动失效，由处理它的线程在处理完毕后重新注册（modify）或者删除（remove），同一时刻只有一个线程处理同一个 channel
+ * @description: 连接不属于任何一个线程，哪个线程空闲就由哪个线程处理，耗时差异很大的请求不会让其他连接滞留在繁忙的线程上
+ * @description: channel 的地址保存在 epoll_event.data.ptr 中，不需要按文件描述符查表；add/modify/remove 只调用 epoll_ctl，可以由任意线程调用
+ */
+class LeaderFollower {
+private:
+	int m_epfd;  // 共享的 epoll 实例
+	int m_thread_num;  // 线程数量
+	std::vector<std::thread*> m_threads;  // 线程数组
+	std::vector<int> m_cpus;  // 线程绑定的 CPU 编号，第 i 个线程绑定第 i 个，未指定的不绑定
+	std::atomic<bool> m_quit;  // 退出标志
+	const int m_max_timeout = 2000;  // epoll_wait 最长阻塞时间（毫秒），用于检查退出标志
+
+private:
+	int epollCtl(Channel* channel, int op);  // 以 EPOLLONESHOT 方式操作共享的 epoll 实例
+	void follow(int index);  // 线程函数，等待并处理就绪事件
+
+public:
+	LeaderFollower(int thread_num);
+	~LeaderFollower();  // 通知线程退出并回收线程
+
+	void run();  // 启动线程
+	int add(Channel* channel);  // 添加
+	int remove(Channel* channel);  // 删除
+	int modify(Channel* channel);  // 修改，同时重新注册
+	inline void setCpus(const std::vector<int>& cpus);  // 设置线程绑定的 CPU，需要在 run 之前调用
+};
+
+inline void LeaderFollower::setCpus(const std::vector<int>& cpus) {
+	m_cpus = cpus;
+}
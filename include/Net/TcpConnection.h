@@ -15,12 +15,28 @@
 #include "HttpResponse.h"
 #include "HttpRequest.h"
 #include "Log.h"
+#include "ComputePool.h"
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+/** 
+ * @description: 空闲计时器、请求计时器与连接共享的状态，计时器可能在其他线程中到期（连接迁移之后、领导者/跟随者模式），通过互斥锁保证连接释放后不会再操作它的文件描述符
+ */
+struct IdleGuard {
+	std::mutex mutex;
+	int fd;  // 连接的文件描述符，连接释放时置为 -1
+	std::atomic<uint64_t> generation;  // 收到数据的次数，计时期间发生变化说明连接已经不再空闲
+	std::atomic<uint64_t> requests;  // 解析完成的请求数量，计时期间发生变化说明请求已经完整到达
+};
 
 /** 
  * @description: TcpConnection 主要负责与客户端进行通信，接收客户端的信息
  * @description: 通过 HttpRequest 解析请求数据，在通过 HttpResponse 组织回复数据
  * @description: 需要注意的事，反应堆实例不属于 TcpConnection，而是 TcpConnection 属于反应堆实例，一个反应堆实例可以被不同的 TcpConnection 调用
  * @description: 一个 TcpConnection 只拥有一个 Channel 对象（封装了通信文件描述符），相当于每当有一个客户端建立连接，就会产生一个 TcpConnection 对象与其通信
+ * @description: 支持 HTTP/1.1 长连接，响应发送完毕后保持连接并等待下一个请求，空闲超时或者达到最多请求数量后断开
+ * @description: 支持 HTTP/1.1 流水线，一次收到的多个请求依次处理，响应按顺序合并后发送
  */
 class TcpConnection {
 private:
@@ -32,6 +48,22 @@ private:
 	// http 
 	HttpRequest* m_request;  // 解析客户端请求数据
 	HttpResponse* m_response;  // 组织返还客户端的数据块
+	ComputePool* m_compute_pool;  // 生成响应体的计算线程池，nullptr 表示在反应堆模型所属线程中生成
+	bool m_body_pending;  // 响应体是否正在计算线程池中生成
+	std::shared_ptr<bool> m_alive;  // 连接是否存活，计算结果交还时判断连接是否已经断开
+	int m_body_fd;  // 正在发送的响应体文件，-1 表示没有
+	static const int m_chunk_size = 16 * 1024;  // 每次从响应体文件中读取的字节数
+	std::string m_request_line;  // 当前请求的请求行，反应堆模型被看门狗检测时才保存
+	bool m_keep_alive;  // 当前响应发送完毕后是否保持连接
+	int m_requests;  // 已经处理的请求数量
+	std::shared_ptr<IdleGuard> m_guard;  // 与空闲计时器共享的状态
+	TimerId m_idle_timer;  // 空闲计时器，0 表示没有
+	EventLoop* m_idle_loop;  // 空闲计时器所在的反应堆模型
+	TimerId m_request_timer;  // 请求计时器，从请求的第一个字节到达开始计时，收到部分数据时不重新计时，0 表示没有
+	EventLoop* m_request_loop;  // 请求计时器所在的反应堆模型
+	static const int m_max_probe_size = 256;  // 请求行最多保存的字节数
+	static const int m_max_pipeline = 16;  // 流水线中每批最多处理的请求数量
+	static const int m_max_pipeline_size = 64 * 1024;  // 发送缓冲区中的数据超过该值时停止处理流水线中的请求
 
 	Log* m_log = Log::getInstance();  // 日志类
 
@@ -39,8 +71,26 @@ private:
 	static int processRead(void* arg);
 	static int processWrite(void* arg);
 	static int destroy(void* arg);
+	void handleRequest();  // 依次处理接收缓冲区中的请求，合并响应后发送
+	bool hasNextRequest();  // 判断是否可以继续处理流水线中的下一个请求
+	bool respondOne();  // 解析并处理一个请求，响应写入发送缓冲区
+	bool buildBody();  // 生成响应体
+	void completeBody(const std::string& body);  // 响应体生成完毕，组织响应头并写入响应体
+	void sendResponse();  // 开始发送缓冲区中的响应数据
+	void finishResponse();  // 响应发送完毕，断开连接或者等待下一个请求
+	bool isResponding();  // 判断是否有正在生成或者发送的响应
+	void armIdleTimer();  // 启动空闲计时器
+	void cancelIdleTimer();  // 取消空闲计时器
+	void armRequestTimer();  // 启动请求计时器
+	void cancelRequestTimer();  // 取消请求计时器
+	bool fillBody();  // 从响应体文件中读取一块数据写入发送缓冲区
+	bool isIdle();  // 判断连接是否空闲（没有正在生成或者发送的响应）
+	void migrate(EventLoop* target);  // 将连接迁移到其他反应堆模型
+	void publishProbe(bool new_request);  // 向看门狗发布当前请求的请求行
 
 public:
-	TcpConnection(int fd, EventLoop* event_loop);
+	TcpConnection(int fd, EventLoop* event_loop, bool edge_trigger = false, ComputePool* compute_pool = nullptr, bool one_shot = false);
 	~TcpConnection();
+
+	static int migrateIdle(EventLoop* source, EventLoop* target, int max_count);  // 将空闲连接从 source 迁移到 target，只能由 source 所属线程调用
 };
\ No newline at end of file
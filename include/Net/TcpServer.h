@@ -12,28 +12,189 @@
 #include "EventLoop.h"
 #include "ThreadPool.h"
 #include "Log.h"
+#include "ComputePool.h"
+#include "LeaderFollower.h"
+#include "Watchdog.h"
+#include <vector>
+#include <list>
+#include <memory>
+#include <atomic>
+
+class TcpServer;
+
+/** 
+ * @description: 线程模型
+ */
+enum class ThreadingMode:char {
+	REACTOR,  // 主从反应堆模型，每个连接固定属于一个子反应堆模型
+	LEADERFOLLOWER  // 领导者/跟随者模型，所有线程共享一个 epoll 实例，空闲线程处理下一个就绪的连接
+};
+
+/** 
+ * @description: 监听器，封装监听套接字以及负责 accept 的反应堆模型，作为监听 channel 的回调参数
+ */
+struct Listener {
+	TcpServer* server;  // 所属服务器
+	EventLoop* event_loop;  // 负责 accept 的子反应堆模型，nullptr 表示由主反应堆模型 accept 后交给线程池分配
+	int lfd;  // 用于监听的文件描述符（非阻塞）
+	int idle_fd;  // 预留的空闲文件描述符，文件描述符耗尽时释放它来接受并关闭新连接
+	Channel* channel;  // 封装监听套接字的 channel，单次触发时 accept 完毕后需要重新注册
+};
+
+/** 
+ * @description: 退役中的子线程，已从线程池中移除，等它的连接全部迁移或关闭后再停止
+ */
+struct RetiringWorker {
+	WorkerThread* worker;  // 退役的子线程
+	std::shared_ptr<std::atomic<int>> fences;  // 尚未执行的栅栏任务数量，归零说明其他子线程中发往它的迁移都已完成
+};
 
 /** 
  * @description: 服务器类
+ * @description: 默认由主反应堆模型监听并 accept，再将通信文件描述符分配给子线程
+ * @description: 开启 SO_REUSEPORT 模式后，每个子反应堆模型各自创建一个绑定同一端口的监听套接字，由内核在各个监听套接字之间分配连接，主线程不再参与 accept
+ * @description: 领导者/跟随者模式下不启动线程池，监听套接字与通信套接字都注册在 LeaderFollower 共享的 epoll 实例中，由空闲线程 accept 与通信，主反应堆模型只接收计算线程池的结果
+ * @description: 设置 setScaling 后，主反应堆模型定时统计子反应堆模型的利用率，在 [min, max] 范围内增加或退役子线程（不支持 SO_REUSEPORT 与领导者/跟随者模式），忙轮询空转的时间不计入利用率
  */
 class TcpServer {
 private:
 	int m_thread_num;  // 线程池线程数量
 	EventLoop* m_main_event_loop;  // 主线程反应堆模型
 	ThreadPool* m_thread_pool;  // 线程池
-	int m_lfd;  // 用于监听的文件描述符
+	std::vector<Listener*> m_listeners;  // 监听器
 	unsigned short m_port;  // 监听端口号
+	bool m_edge_trigger = false;  // 通信文件描述符是否使用边沿触发（仅 epoll 生效）
+	bool m_reuse_port = false;  // 是否每个子反应堆模型各自监听（SO_REUSEPORT）
+	int m_accept_batch = 64;  // 每次监听事件最多 accept 的连接数量
+	static const int m_accept_retry = 100;  // 文件描述符耗尽时暂停监听的时间（毫秒）
+	int m_main_cpu = -1;  // 主线程绑定的 CPU，小于 0 表示不绑定
+	int m_log_cpu = -1;  // 日志线程绑定的 CPU，小于 0 表示不绑定
+	int m_compute_threads = 0;  // 计算线程数量，0 表示不使用计算线程池
+	ComputePool* m_compute_pool = nullptr;  // 计算线程池
+	ThreadingMode m_threading_mode = ThreadingMode::REACTOR;  // 线程模型
+	LeaderFollower* m_leader_follower = nullptr;  // 领导者/跟随者模式共享的 epoll 实例与线程
+	std::vector<int> m_worker_cpus;  // 子线程（或跟随者线程）绑定的 CPU
+	int m_busy_poll_us = 0;  // 子反应堆模型忙轮询的自旋预算（微秒），0 表示不自旋
+	int m_socket_busy_poll_us = 0;  // 通信套接字的 SO_BUSY_POLL（微秒），0 表示不设置
+	int m_write_budget = 64 * 1024;  // 每个连接每轮最多发送（读取）的字节数
+	int m_turn_budget_us = 5000;  // 每个反应堆模型每轮处理就绪事件的时间预算（微秒），0 表示不限制
+	int m_rebalance_interval = 0;  // 负载均衡的检查间隔（毫秒），0 表示不迁移连接
+	int m_rebalance_threshold = 0;  // 连接数量之差超过该值时才迁移
+	int m_min_threads = 0;  // 动态扩缩容时的最少子线程数量
+	int m_max_threads = 0;  // 动态扩缩容时的最多子线程数量，不大于 m_min_threads 表示不扩缩容
+	int m_scale_interval = 1000;  // 扩缩容的检查间隔（毫秒）
+	int64_t m_last_scale_time = 0;  // 上一次检查的时间（微秒）
+	std::vector<uint64_t> m_last_busy;  // 上一次检查时各个子反应堆模型的累计忙碌时间（微秒）
+	std::list<RetiringWorker> m_retiring;  // 退役中的子线程
+	int m_stall_threshold_ms = 0;  // 看门狗的阻塞阈值（毫秒），0 表示不启动看门狗
+	int m_idle_timeout = 15000;  // 长连接的空闲超时时间（毫秒），0 表示每个请求处理完毕后断开
+	int m_max_requests = 1000;  // 每个长连接最多处理的请求数量，0 表示不限制
+	Watchdog* m_watchdog = nullptr;  // 看门狗
 	Log* m_log = Log::getInstance();  // 日志类
 
 private:
-	void setListen();  // 初始化监听器
+	int setListen(bool reuse_port);  // 初始化监听器
+	void addListener(EventLoop* event_loop);  // 创建监听器并交给反应堆模型检测
 	static int acceptConnection(void* arg);  // 建立连接
+	static void createConnection(EventLoop* event_loop, void* arg, int fd);  // 在子线程中为交付的通信文件描述符创建连接
+	void pauseListener(Listener* listener);  // 暂停检测监听套接字，一段时间后恢复
+	void rebalance();  // 将空闲连接从最忙的子线程迁移到最闲的子线程
+	void scale();  // 根据子反应堆模型的利用率扩容或缩容
+	void retire();  // 移除一个子线程并开始排空
+	void drain();  // 迁移退役子线程的空闲连接，排空后停止
+	void configureWorker(EventLoop* event_loop);  // 将忙轮询、工作预算等设置应用到子反应堆模型
 
 public:
-	TcpServer(unsigned short port, int thread_num);
+	TcpServer(unsigned short port, int thread_num, DispatcherType type = DispatcherType::EPOLL, int expected_fds = 256);
 	~TcpServer() = default;
 
 	void run();  // 启动服务器
+	inline void setEdgeTrigger(bool flag);  // 设置通信文件描述符的触发方式，需要在 run 之前调用
+	inline void setReusePort(bool flag);  // 设置是否每个子反应堆模型各自监听，需要在 run 之前调用
+	inline void setAcceptBatch(int batch);  // 设置每次监听事件最多 accept 的连接数量，需要在 run 之前调用
+	inline void setSelectPolicy(SelectPolicy policy);  // 设置子线程选择策略
+	inline void setComputeThreads(int num);  // 设置计算线程数量，需要在 run 之前调用
+	inline void setThreadingMode(ThreadingMode mode);  // 设置线程模型，需要在 run 之前调用
+	inline void setBusyPoll(int budget_us, int socket_busy_poll_us = 0);  // 设置子反应堆模型的忙轮询，需要在 run 之前调用
+	inline void setWorkBudget(int write_budget, int turn_budget_us);  // 设置工作预算，需要在 run 之前调用
+	inline void setRebalance(int interval, int threshold);  // 设置连接迁移的检查间隔（毫秒）与阈值，需要在 run 之前调用
+	inline void setScaling(int min_threads, int max_threads, int interval = 1000);  // 设置子线程数量的动态范围与检查间隔（毫秒），需要在 run 之前调用
+	inline void setWatchdog(int threshold_ms);  // 启动看门狗，一轮处理超过 threshold_ms 毫秒时报告阻塞，需要在 run 之前调用
+	inline void setKeepAlive(int idle_timeout, int max_requests);  // 设置长连接的空闲超时时间（毫秒）与最多请求数量，需要在 run 之前调用
+	BusyPollStats getBusyPollStats();  // 汇总各个子反应堆模型的忙轮询统计，需要在 run 启动线程池之后调用
+
+	// 绑核，都需要在 run 之前调用
+	inline void setMainCpu(int cpu);  // 设置主线程绑定的 CPU
+	inline void setLogCpu(int cpu);  // 设置日志线程绑定的 CPU
+	inline void setWorkerCpus(const std::vector<int>& cpus);  // 设置子线程绑定的 CPU
+	bool bindWorkersToNic(const std::string& interface);  // 子线程绑定到网卡队列中断所在的 CPU
 };
 
+inline void TcpServer::setEdgeTrigger(bool flag) {
+	m_edge_trigger = flag;
+}
+
+inline void TcpServer::setReusePort(bool flag) {
+	m_reuse_port = flag;
+}
+
+inline void TcpServer::setAcceptBatch(int batch) {
+	m_accept_batch = batch > 0 ? batch : 1;
+}
+
+inline void TcpServer::setSelectPolicy(SelectPolicy policy) {
+	m_thread_pool->setSelectPolicy(policy);
+}
+
+inline void TcpServer::setComputeThreads(int num) {
+	m_compute_threads = num;
+}
+
+inline void TcpServer::setThreadingMode(ThreadingMode mode) {
+	m_threading_mode = mode;
+}
+
+inline void TcpServer::setBusyPoll(int budget_us, int socket_busy_poll_us) {
+	m_busy_poll_us = budget_us;
+	m_socket_busy_poll_us = socket_busy_poll_us;
+}
+
+inline void TcpServer::setWorkBudget(int write_budget, int turn_budget_us) {
+	m_write_budget = write_budget;
+	m_turn_budget_us = turn_budget_us;
+}
+
+inline void TcpServer::setRebalance(int interval, int threshold) {
+	m_rebalance_interval = interval;
+	m_rebalance_threshold = threshold > 0 ? threshold : 1;
+}
+
+inline void TcpServer::setScaling(int min_threads, int max_threads, int interval) {
+	m_min_threads = min_threads > 1 ? min_threads : 1;
+	m_max_threads = max_threads;
+	m_scale_interval = interval > 0 ? interval : 1000;
+}
+
+inline void TcpServer::setWatchdog(int threshold_ms) {
+	m_stall_threshold_ms = threshold_ms;
+}
+
+inline void TcpServer::setKeepAlive(int idle_timeout, int max_requests) {
+	m_idle_timeout = idle_timeout;
+	m_max_requests = max_requests;
+}
+
+inline void TcpServer::setMainCpu(int cpu) {
+	m_main_cpu = cpu;
+}
+
+inline void TcpServer::setLogCpu(int cpu) {
+	m_log_cpu = cpu;
+}
+
+inline void TcpServer::setWorkerCpus(const std::vector<int>& cpus) {
+	m_worker_cpus = cpus;
+	m_thread_pool->setWorkerCpus(cpus);
+}
+
 
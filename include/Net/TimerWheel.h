@@ -0,0 +1,78 @@
+/** 
+ * @author: yuyuyuj1e 807152541@qq.com
+ * @github: https://github.com/yuyuyuj1e
+ * @csdn: https://blog.csdn.net/yuyuyuj1e
+ * @date: 2023-03-22 09:41:27
+ * @last_edit_time: 2023-03-22 09:41:27
+ * @file_path: /CC/include/Net/TimerWheel.h
+ * @description: 分层时间轮模块头文件
+ */
+
+#pragma once
+#include <functional>
+#include <unordered_map>
+#include <atomic>
+#include <stdint.h>
+
+using TimerId = uint64_t;  // 定时器编号，0 表示无效定时器
+
+/**
+ * @description: 定时器节点，通过双向链表挂在时间轮的槽位上，插入和删除都是 O(1)
+ */
+struct TimerNode {
+	TimerId id;  // 定时器编号
+	int64_t expire;  // 到期时间（毫秒）
+	int64_t interval;  // 重复间隔（毫秒），0 表示只执行一次
+	std::function<void()> callback;  // 到期回调
+	TimerNode* prev;
+	TimerNode* next;
+	TimerNode** head;  // 所在链表的头指针，删除节点时使用
+};
+
+/**
+ * @description: 分层时间轮，精度为 1 毫秒，由反应堆模型所属线程独占使用
+ * @description: 第 0 层 256 个槽位，每个槽位 1 毫秒；第 1 ~ 3 层各 64 个槽位，每层槽位跨度是上一层的一圈，最大可表示约 18 小时，更远的定时器在最后一层中反复降级
+ * @description: 第 0 层转完一圈时，将上一层当前槽位中的定时器重新分配（降级）到下层
+ */
+class TimerWheel {
+private:
+	static const int m_level0_bits = 8;
+	static const int m_level_bits = 6;
+	static const int m_level0_size = 1 << m_level0_bits;  // 第 0 层槽位数量
+	static const int m_level_size = 1 << m_level_bits;  // 第 1 ~ 3 层槽位数量
+	static const int m_levels = 4;  // 层数
+
+	TimerNode* m_level0[m_level0_size];  // 第 0 层
+	TimerNode* m_upper[m_levels - 1][m_level_size];  // 第 1 ~ 3 层
+	TimerNode* m_expiring;  // 正在执行的到期定时器
+	int64_t m_current;  // 时间轮当前时间（毫秒）
+	std::unordered_map<TimerId, TimerNode*> m_timers;  // 根据编号找到定时器，用于取消
+	std::atomic<TimerId> m_next_id;  // 下一个定时器编号，允许其他线程预先申请编号
+
+private:
+	void place(TimerNode* node);  // 根据到期时间将节点放入对应槽位
+	void link(TimerNode** head, TimerNode* node);  // 将节点插入链表
+	void unlink(TimerNode* node);  // 将节点从所在链表中移除
+	void cascade(TimerNode** head);  // 将上层槽位中的节点降级
+	void tick();  // 时间轮前进 1 毫秒，执行到期的定时器
+
+public:
+	TimerWheel();
+	~TimerWheel();
+	TimerWheel(const TimerWheel&) = delete;
+	TimerWheel& operator=(const TimerWheel&) = delete;
+
+	static int64_t nowMs();  // 获取单调时钟的当前时间（毫秒）
+	static int64_t nowUs();  // 获取单调时钟的当前时间（微秒）
+
+	TimerId nextId();  // 申请一个定时器编号（线程安全）
+	void add(TimerId id, int64_t delay, int64_t interval, std::function<void()> callback);  // 添加定时器
+	bool cancel(TimerId id);  // 取消定时器
+	void advance(int64_t now);  // 推进时间轮并执行到期的定时器
+	int nextTimeout(int max_timeout);  // 距离下一次可能到期的时间（毫秒）
+	inline bool empty();
+};
+
+inline bool TimerWheel::empty() {
+	return m_timers.empty();
+}
@@ -0,0 +1,58 @@
+/** 
+ * @author: yuyuyuj1e 807152541@qq.com
+ * @github: https://github.com/yuyuyuj1e
+ * @csdn: https://blog.csdn.net/yuyuyuj1e
+ * @date: 2023-03-27 15:06:42
+ * @last_edit_time: 2023-03-27 15:06:42
+ * @file_path: /CC/include/Net/Watchdog.h
+ * @description: 事件循环看门狗头文件
+ */
+
+#pragma once
+#include "EventLoop.h"
+#include "Log.h"
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <string>
+
+/** 
+ * @description: 看门狗，独立线程周期读取各个反应堆模型的心跳，发现某一轮处理时间超过阈值时输出阻塞信息
+ * @description: 阻塞信息包括所属线程、已阻塞的时间、所处阶段（读/写回调、定时器、任务队列），在 channel 回调中阻塞时还包括文件描述符与连接的请求行
+ * @description: 每一轮最多报告一次；反应堆模型自己记录每轮耗时的分布，看门狗定期把有新阻塞的分布写入日志，用于找出造成延迟尖刺的代码路径
+ * @description: 看门狗只读取原子变量，不会影响被检测的线程；检测列表由互斥锁保护，运行期间可以增删反应堆模型
+ */
+class Watchdog {
+private:
+	// 被检测的反应堆模型
+	struct Watched {
+		EventLoop* event_loop;
+		int64_t reported_start;  // 已经报告过的一轮的开始时间，避免同一轮重复报告
+		uint64_t stalls;  // 超过阈值的次数
+		uint64_t reported_stalls;  // 上一次输出分布时的 stalls
+	};
+
+	std::vector<Watched> m_watched;  // 检测列表
+	std::mutex m_mutex;  // 保护检测列表
+	int m_threshold_ms;  // 阻塞阈值（毫秒）
+	int m_report_interval_ms = 60000;  // 输出耗时分布的间隔（毫秒）
+	std::thread* m_thread;  // 看门狗线程
+	std::atomic<bool> m_quit;  // 退出标志
+	Log* m_log = Log::getInstance();  // 日志类
+
+private:
+	void running();  // 线程函数，周期检测
+	void check(Watched& watched, int64_t now);  // 检测一个反应堆模型
+	void report();  // 输出有新阻塞的反应堆模型的耗时分布
+	static const char* stageName(LoopStage stage);  // 阶段名称
+
+public:
+	Watchdog(int threshold_ms);
+	~Watchdog();  // 通知线程退出并回收线程
+
+	void run();  // 启动看门狗线程
+	void watch(EventLoop* event_loop);  // 添加被检测的反应堆模型
+	void unwatch(EventLoop* event_loop);  // 移除被检测的反应堆模型，反应堆模型释放之前调用
+	std::string histogram(EventLoop* event_loop);  // 格式化反应堆模型的耗时分布
+};
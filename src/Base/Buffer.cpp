@@ -105,7 +105,7 @@ int Buffer::appendData(const std::string data) {
 /** 
  * @description: 接收指定客户端发送过来的数据
  * @param {int} fd: 通信套接字
- * @return {int} 成功返回接收数据大小；失败返回 0
+ * @return {int} 成功返回接收数据大小；对端关闭返回 0；失败返回 -1
  */
 int Buffer::readData(int fd) {
 	// read/recv 只能指定一个数组（接收数据），readv 可以指定多个数组（接收数据）
@@ -125,7 +125,8 @@ int Buffer::readData(int fd) {
 
 	// 接收数据
 	int result = readv(fd, vec, 2);
-	if (result == -1) {  // 接收失败
+	if (result == -1) {  // 接收失败（非阻塞套接字没有数据时 errno 为 EAGAIN）
+		free(tmp_buf);
 		return -1;
 	}
 	else if (result <= writeable) {  // buffer 内存块足够用
@@ -155,7 +156,6 @@ int Buffer::sendData(int fd) {
 		int count = send(fd, m_data + m_read_pos, readable, MSG_NOSIGNAL);
 		if (count > 0) {
 			m_read_pos += count;
-			usleep(1);
 		}
 		return count;
 	}
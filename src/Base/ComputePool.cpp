@@ -0,0 +1,134 @@
+/** 
+ * @author: yuyuyuj1e 807152541@qq.com
+ * @github: https://github.com/yuyuyuj1e
+ * @csdn: https://blog.csdn.net/yuyuyuj1e
+ * @date: 2023-03-24 10:20:37
+ * @last_edit_time: 2023-03-24 10:20:37
+ * @file_path: /CC/src/Base/ComputePool.cpp
+ * @description: 计算线程池源文件
+ */
+
+#include "ComputePool.h"
+
+namespace {
+	thread_local ComputePool* t_pool = nullptr;  // 当前线程所属的计算线程池
+	thread_local int t_index = -1;  // 当前线程在计算线程池中的下标
+}
+
+ComputePool::ComputePool(int thread_num) {
+	m_thread_num = thread_num > 0 ? thread_num : 1;
+	for (int i = 0; i < m_thread_num; ++i) {
+		m_workers.push_back(new Worker);
+	}
+	m_pending = 0;
+	m_next = 0;
+	m_stop = false;
+}
+
+ComputePool::~ComputePool() {
+	{
+		std::lock_guard<std::mutex> locker(m_mutex);
+		m_stop = true;
+	}
+	m_cond.notify_all();
+	for (auto item : m_threads) {
+		item->join();
+		delete item;
+	}
+	for (auto item : m_workers) {
+		delete item;
+	}
+}
+
+/** 
+ * @description: 启动计算线程
+ */
+void ComputePool::run() {
+	for (int i = 0; i < m_thread_num; ++i) {
+		m_threads.push_back(new std::thread(&ComputePool::working, this, i));
+	}
+}
+
+/** 
+ * @description: 提交任务，计算线程提交的子任务放入自己的队列，其他线程提交的任务轮询放入各个队列
+ * @param {Task} task: 任务
+ */
+void ComputePool::submit(Task task) {
+	int index = (t_pool == this) ? t_index : static_cast<int>(m_next.fetch_add(1, std::memory_order_relaxed) % m_thread_num);
+	{
+		std::lock_guard<std::mutex> locker(m_workers[index]->mutex);
+		m_workers[index]->tasks.push_back(std::move(task));
+	}
+	m_pending.fetch_add(1);
+
+	// 先加锁再唤醒，避免计算线程检查完 m_pending 之后、休眠之前错过通知
+	{
+		std::lock_guard<std::mutex> locker(m_mutex);
+	}
+	m_cond.notify_one();
+}
+
+/** 
+ * @description: 在计算线程中执行 work，执行完毕后将 done 投递到 event_loop 中执行
+ * @param {Task} work: 计算任务
+ * @param {EventLoop*} event_loop: 接收结果的反应堆模型
+ * @param {Functor} done: 在反应堆模型所属线程中执行的回调，通常负责把结果写入发送缓冲区
+ */
+void ComputePool::submit(Task work, EventLoop* event_loop, EventLoop::Functor done) {
+	submit([work, event_loop, done]() {
+		work();
+		event_loop->queueInLoop(done);
+	});
+}
+
+/** 
+ * @description: 先从自己队列的尾部取任务，为空时从下一个线程开始依次从其他队列的头部窃取
+ * @param {int} index: 计算线程下标
+ * @param {Task&} task: 传出参数，取出的任务
+ * @return {bool} 取到任务返回 true
+ */
+bool ComputePool::take(int index, Task& task) {
+	for (int i = 0; i < m_thread_num; ++i) {
+		Worker* worker = m_workers[(index + i) % m_thread_num];
+		std::lock_guard<std::mutex> locker(worker->mutex);
+		if (worker->tasks.empty()) {
+			continue;
+		}
+		if (i == 0) {
+			task = std::move(worker->tasks.back());
+			worker->tasks.pop_back();
+		}
+		else {
+			task = std::move(worker->tasks.front());
+			worker->tasks.pop_front();
+		}
+		m_pending.fetch_sub(1);
+		return true;
+	}
+	return false;
+}
+
+/** 
+ * @description: 计算线程工作函数，没有任务时休眠，直到有新任务或者线程池退出
+ * @param {int} index: 计算线程下标
+ */
+void ComputePool::working(int index) {
+	t_pool = this;
+	t_index = index;
+	Task task;
+	while (true) {
+		if (take(index, task)) {
+			task();
+			task = nullptr;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> locker(m_mutex);
+		while (!m_stop && m_pending.load() == 0) {
+			m_cond.wait(locker);
+		}
+		if (m_stop) {
+			break;
+		}
+	}
+}
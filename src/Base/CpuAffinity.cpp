@@ -0,0 +1,136 @@
+/** 
+ * @author: yuyuyuj1e 807152541@qq.com
+ * @github: https://github.com/yuyuyuj1e
+ * @csdn: https://blog.csdn.net/yuyuyuj1e
+ * @date: 2023-03-23 15:06:18
+ * @last_edit_time: 2023-03-23 15:06:18
+ * @file_path: /CC/src/Base/CpuAffinity.cpp
+ * @description: CPU 亲和性模块源文件
+ */
+
+#include "CpuAffinity.h"
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fstream>
+
+namespace {
+	/** 
+	 * @description: 获取当前线程的 CPU 集合，失败时返回全部 CPU
+	 * @return {cpu_set_t} CPU 集合
+	 */
+	cpu_set_t currentMask() {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+			for (int i = 0; i < CPU_SETSIZE; ++i) {
+				CPU_SET(i, &set);
+			}
+		}
+		return set;
+	}
+
+	// 进程启动时（main 之前，尚未绑核）的 CPU 集合；新线程会继承创建者的 CPU 集合，不绑定的线程需要恢复为该集合
+	const cpu_set_t g_initial_mask = currentMask();
+
+	/** 
+	 * @description: 设置线程的 CPU 集合
+	 * @param {pthread_t} thread: 线程
+	 * @param {int} cpu: CPU 编号，小于 0 表示恢复为进程启动时的 CPU 集合
+	 * @return {int} 成功返回 0；失败返回 -1
+	 */
+	int setAffinity(pthread_t thread, int cpu) {
+		cpu_set_t set = g_initial_mask;
+		if (cpu >= 0) {
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+		}
+		int ret = pthread_setaffinity_np(thread, sizeof(set), &set);
+		if (ret != 0) {
+			errno = ret;
+			perror("pthread_setaffinity_np");
+			return -1;
+		}
+		return 0;
+	}
+}
+
+
+/** 
+ * @return {int} 在线的 CPU 数量
+ */
+int CpuAffinity::cpuCount() {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? static_cast<int>(count) : 1;
+}
+
+/** 
+ * @description: 将当前线程绑定到指定 CPU，之后申请的内存会分配在该 CPU 所在的 NUMA 节点上
+ * @description: 不绑定时恢复为进程启动时的 CPU 集合，不继承创建者（例如已经绑核的主线程）的绑定
+ * @param {int} cpu: CPU 编号，小于 0 表示不绑定
+ * @return {int} 成功返回 0；失败返回 -1
+ */
+int CpuAffinity::bindCurrentThread(int cpu) {
+	return setAffinity(pthread_self(), cpu);
+}
+
+/** 
+ * @description: 将指定线程绑定到指定 CPU，不绑定时恢复为进程启动时的 CPU 集合
+ * @param {thread*} thread: 已经启动的线程
+ * @param {int} cpu: CPU 编号，小于 0 表示不绑定
+ * @return {int} 成功返回 0；失败返回 -1
+ */
+int CpuAffinity::bindThread(std::thread* thread, int cpu) {
+	if (thread == nullptr) {
+		return 0;
+	}
+	return setAffinity(thread->native_handle(), cpu);
+}
+
+/** 
+ * @description: 从 /proc/interrupts 中找出属于该网卡的中断（每个收发队列一个），再从 /proc/irq/N/smp_affinity_list 中读取处理该中断的 CPU
+ * @description: 中断名称（每行最后一列）等于网卡名或者以 "网卡名-" 开头才算匹配，eth1 不会匹配到 eth10 的队列
+ * @description: 将子线程绑定到对应的 CPU 上，软中断处理完的数据包直接在同一个 CPU 的缓存中被读取
+ * @param {string&} interface: 网卡名，例如 eth0
+ * @return {vector<int>} 按队列顺序排列的 CPU 编号，找不到时为空
+ */
+std::vector<int> CpuAffinity::nicQueueCpus(const std::string& interface) {
+	std::vector<int> cpus;
+	std::ifstream interrupts("/proc/interrupts");
+	if (!interrupts.is_open() || interface.empty()) {
+		return cpus;
+	}
+
+	std::string line;
+	std::string prefix = interface + "-";
+	while (std::getline(interrupts, line)) {
+		size_t last = line.find_last_not_of(" \t");
+		if (last == std::string::npos) {
+			continue;
+		}
+		size_t first = line.find_last_of(" \t", last);
+		first = first == std::string::npos ? 0 : first + 1;
+		std::string name = line.substr(first, last - first + 1);  // 中断名称
+		if (name != interface && name.compare(0, prefix.size(), prefix) != 0) {
+			continue;
+		}
+		// 每行的格式为 "  45:  0  0  ...  IR-PCI-MSI 524288-edge  eth0-TxRx-0"，只处理编号为数字的中断
+		char* end = nullptr;
+		long irq = strtol(line.c_str(), &end, 10);
+		if (end == line.c_str() || *end != ':') {
+			continue;
+		}
+
+		std::ifstream affinity("/proc/irq/" + std::to_string(irq) + "/smp_affinity_list");
+		std::string list;
+		if (!affinity.is_open() || !std::getline(affinity, list) || list.empty()) {
+			continue;
+		}
+		// 格式为 "2"、"0-3" 或 "0,4"，中断可以由多个 CPU 处理时取第一个
+		cpus.push_back(atoi(list.c_str()));
+	}
+	return cpus;
+}
@@ -11,6 +11,11 @@
 #include "ThreadPool.h"
 #include <assert.h>
 #include <stdlib.h>
+#include <sys/socket.h>
+
+#ifndef SO_INCOMING_CPU
+#define SO_INCOMING_CPU 49  // Linux 3.19 引入，旧版本的头文件中没有定义
+#endif
 
 
 ThreadPool::ThreadPool(EventLoop* main_loop, int count) {
@@ -19,6 +24,8 @@ ThreadPool::ThreadPool(EventLoop* main_loop, int count) {
 	m_main_loop = main_loop;
 	m_thread_num = count;
 	m_worker_threads.clear();
+	m_policy = SelectPolicy::ROUNDROBIN;
+	m_random = 2463534242u;
 }
 
 ThreadPool::~ThreadPool() {
@@ -37,28 +44,161 @@ void ThreadPool::run() {
 
 
 	// 构造子线程，如果设置的 m_thread_num <= 0，则表明使用单反应堆模型，即只使用主反应堆模型
-	if (m_thread_num > 0) {
+	int count = m_thread_num;
+	for (int i = 0; i < count; ++i) {
+		addWorker();
+	}
+}
+
+/** 
+ * @description: 添加一个子线程，线程池启动后由主线程调用，可以在运行期间扩容
+ * @return {EventLoop*} 新子线程的反应堆实例
+ */
+EventLoop* ThreadPool::addWorker() {
+	assert(m_start && m_main_loop->getThreadID() == std::this_thread::get_id());
+
+	int index = static_cast<int>(m_worker_threads.size());
+	int cpu = index < static_cast<int>(m_worker_cpus.size()) ? m_worker_cpus[index] : -1;
+	WorkerThread* sub_thread = new WorkerThread(index, cpu, m_main_loop->getDispatcherType());  // 子线程与主线程使用相同的底层实现
+	sub_thread->run();
+	m_worker_threads.push_back(sub_thread);  // 加入子线程队列
+	m_thread_num = static_cast<int>(m_worker_threads.size());
+	return sub_thread->getEventLoop();
+}
+
+/** 
+ * @description: 从线程池中移除最后一个子线程，由主线程调用，之后不会再给它分配新连接
+ * @description: 被移除的子线程仍在运行，调用者需要先迁移或等待关闭它的所有连接，再调用 WorkerThread::stop 并释放
+ * @return {WorkerThread*} 被移除的子线程，只剩一个子线程时返回 nullptr
+ */
+WorkerThread* ThreadPool::removeWorker() {
+	assert(m_start && m_main_loop->getThreadID() == std::this_thread::get_id());
+	if (m_worker_threads.size() <= 1) {
+		return nullptr;
+	}
+
+	WorkerThread* sub_thread = m_worker_threads.back();
+	m_worker_threads.pop_back();
+	m_thread_num = static_cast<int>(m_worker_threads.size());
+	m_index %= m_thread_num;
+	return sub_thread;
+}
+
+/** 
+ * @description: 生成随机数，xorshift 足以打散选择结果，且不需要加锁
+ * @return {int} 非负随机数
+ */
+int ThreadPool::nextRandom() {
+	m_random ^= m_random << 13;
+	m_random ^= m_random >> 17;
+	m_random ^= m_random << 5;
+	return static_cast<int>(m_random & 0x7fffffff);
+}
+
+/** 
+ * @description: 读取套接字的 SO_INCOMING_CPU（处理该连接数据包软中断的 CPU），选出绑定在该 CPU 上的子线程
+ * @description: 软中断、套接字与处理函数在同一个 CPU 上时，每个数据包都不需要跨核访问套接字的缓存行；多个子线程绑定同一 CPU 时选择连接数量最少的
+ * @description: 子线程没有绑核、读取失败或者没有子线程绑定在该 CPU 上时返回 -1，由调用者退化为轮询；网卡多队列时配合 TcpServer::bindWorkersToNic 使用效果最好
+ * @param {int} cfd: 通信文件描述符
+ * @return {int} 子线程下标，找不到时返回 -1
+ */
+int ThreadPool::selectByIncomingCpu(int cfd) {
+	int cpu = -1;
+	socklen_t len = sizeof(cpu);
+	if (cfd == -1 || getsockopt(cfd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) == -1 || cpu < 0) {
+		return -1;
+	}
+
+	int index = -1;
+	int least = 0;
+	int bound = m_thread_num < static_cast<int>(m_worker_cpus.size()) ? m_thread_num : static_cast<int>(m_worker_cpus.size());
+	for (int i = 0; i < bound; ++i) {
+		if (m_worker_cpus[i] != cpu) {
+			continue;
+		}
+		int count = m_worker_threads[i]->getEventLoop()->getConnectionCount();
+		if (index == -1 || count < least) {
+			index = i;
+			least = count;
+		}
+	}
+	return index;
+}
+
+/** 
+ * @description: 根据选择策略选出子线程下标，负载计数由各个子线程原子更新，这里读到的是近似值
+ * @param {const sockaddr_in*} addr: 客户端地址，为 nullptr 时 IPHASH 退化为轮询
+ * @param {int} cfd: 通信文件描述符，为 -1 时 INCOMINGCPU 退化为轮询
+ * @return {int} 子线程下标
+ */
+int ThreadPool::selectWorker(const struct sockaddr_in* addr, int cfd) {
+	int index = 0;
+	switch (m_policy) {
+	case SelectPolicy::LEASTCONNECTION: {
+		// 从轮询位置开始查找，连接数量相同时依次分配，避免总是选中 0 号子线程
+		int least = -1;
 		for (int i = 0; i < m_thread_num; ++i) {
-			WorkerThread* sub_thread = new WorkerThread(i);
-			sub_thread->run();
-			m_worker_threads.push_back(sub_thread);  // 加入子线程队列
+			int candidate = (m_index + i) % m_thread_num;
+			int count = m_worker_threads[candidate]->getEventLoop()->getConnectionCount();
+			if (least == -1 || count < least) {
+				least = count;
+				index = candidate;
+			}
+		}
+		m_index = (index + 1) % m_thread_num;
+		break;
+	}
+	case SelectPolicy::POWEROFTWO: {
+		// 只比较两个随机子线程，开销与子线程数量无关，同时避免所有连接同时涌向负载最低的子线程
+		int first = nextRandom() % m_thread_num;
+		int second = nextRandom() % m_thread_num;
+		int first_score = m_worker_threads[first]->getEventLoop()->getLoadScore();
+		int second_score = m_worker_threads[second]->getEventLoop()->getLoadScore();
+		index = first_score <= second_score ? first : second;
+		break;
+	}
+	case SelectPolicy::INCOMINGCPU: {
+		index = selectByIncomingCpu(cfd);
+		bool hit = index != -1;
+		if (!hit) {  // 没有匹配的子线程时退化为轮询
+			index = m_index;
+			m_index = (m_index + 1) % m_thread_num;
+		}
+		m_worker_threads[index]->getEventLoop()->incomingCpuRouted(hit);
+		break;
+	}
+	case SelectPolicy::IPHASH:
+		if (addr != nullptr) {
+			uint32_t hash = ntohl(addr->sin_addr.s_addr) * 2654435761u;  // 乘法哈希，打散相邻的地址
+			index = static_cast<int>(hash % m_thread_num);
+		}
+		else {  // 没有客户端地址时退化为轮询
+			index = m_index;
+			m_index = (m_index + 1) % m_thread_num;
 		}
+		break;
+	default:
+		index = m_index;
+		m_index = (m_index + 1) % m_thread_num;
+		break;
 	}
+	return index;
 }
 
 /** 
- * @description: 获取一个子线程的反应堆实例，取出规则从0号开始以此取出一个，到最大数量后继续从0号取出
+ * @description: 获取一个子线程的反应堆实例，默认从0号开始以此取出一个，到最大数量后继续从0号取出，也可以通过 setSelectPolicy 设置其他选择策略
+ * @param {const sockaddr_in*} addr: 客户端地址
+ * @param {int} cfd: 通信文件描述符
  * @return {EventLoop*} 返回一个子线程的反应堆实例
  */
-EventLoop* ThreadPool::takeWorkerEventLoop() {
+EventLoop* ThreadPool::takeWorkerEventLoop(const struct sockaddr_in* addr, int cfd) {
 	assert(m_start);  // 线程池已经被启动
 	assert(m_main_loop->getThreadID() == std::this_thread::get_id());  // 由主线程启动
 
 	// 取出子线程的反应堆实例
 	EventLoop* sub_event_loop = m_main_loop;  // 如果没有子线程，则使用主线程（此时为单反应堆模型）
 	if (m_thread_num > 0) {
-		sub_event_loop = m_worker_threads[m_index]->getEventLoop();
-		m_index = ++m_index % m_thread_num;
+		sub_event_loop = m_worker_threads[selectWorker(addr, cfd)]->getEventLoop();
 	}
 	return sub_event_loop;
 }
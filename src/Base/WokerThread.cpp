@@ -9,31 +9,49 @@
  */
 
 #include "WokerThread.h"
+#include "CpuAffinity.h"
 
 /** 
- * @description: 子线程工作函数
+ * @description: 子线程工作函数，先绑核再创建反应堆模型，使反应堆模型以及之后创建的连接都分配在本地 NUMA 节点上
  */
 void WorkerThread::running() {
+	CpuAffinity::bindCurrentThread(m_cpu);
+
 	m_mutex.lock();  // 等待主线程 wait 释放锁，
-	m_event_loop = new EventLoop(m_name);  // 创建子线程的反应堆模型
+	m_event_loop = new EventLoop(m_name, m_dispatcher_type);  // 创建子线程的反应堆模型
 	m_mutex.unlock();
 
 	m_cond.notify_one();  // 唤醒主线程
 
-	m_event_loop->run();  // 运行子反应堆模型
+	m_event_loop->run();  // 运行子反应堆模型，quit 之后返回
+	delete m_event_loop;  // 反应堆模型需要在所属线程中析构
 }
 
-WorkerThread::WorkerThread(int index) {
+WorkerThread::WorkerThread(int index, int cpu, DispatcherType type) {
 	m_event_loop = nullptr;
+	m_cpu = cpu;
+	m_dispatcher_type = type;
 	m_thread = nullptr;
 	m_threadID = std::thread::id();
 	m_name = "SubThread-" + std::to_string(index);
 }
 
 WorkerThread::~WorkerThread() {
-	if (m_thread != nullptr) {
-		delete m_thread;
+	stop();
+}
+
+/** 
+ * @description: 通知反应堆模型退出并等待子线程结束，由主线程调用，调用之前需要先迁移或关闭该子线程上的所有连接
+ */
+void WorkerThread::stop() {
+	if (m_thread == nullptr) {
+		return;
 	}
+	m_event_loop->quit();
+	m_thread->join();
+	delete m_thread;
+	m_thread = nullptr;
+	m_event_loop = nullptr;
 }
 
 /** 
@@ -0,0 +1,172 @@
+/** 
+ * @author: yuyuyuj1e 807152541@qq.com
+ * @github: https://github.com/yuyuyuj1e
+ * @csdn: https://blog.csdn.net/yuyuyuj1e
+ * @date: 2023-03-25 16:42:03
+ * @last_edit_time: 2023-03-25 16:42:03
+ * @file_path: /CC/src/Dispatcher/DispatcherSelector.cpp
+ * @description: 分发器选择模块源文件
+ */
+
+#include "DispatcherSelector.h"
+#include "IoUringDispatcher.h"
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <strings.h>
+#include <chrono>
+#include <vector>
+
+namespace {
+	// 自检时每个 socketpair 读端对应的回调参数
+	struct Probe {
+		EventLoop* event_loop;
+		Channel* channel;
+		int* received;  // 所有读端累计读到的字节数
+	};
+
+	int probeRead(void* arg) {
+		Probe* probe = static_cast<Probe*>(arg);
+		char buf[64];
+		int len = 0;
+		while ((len = read(probe->channel->getSocket(), buf, sizeof buf)) > 0) {
+			*probe->received += len;
+		}
+		return 0;
+	}
+
+	int probeDestroy(void* arg) {
+		Probe* probe = static_cast<Probe*>(arg);
+		probe->event_loop->freeChannel(probe->channel);  // 关闭读端
+		return 0;
+	}
+}
+
+/** 
+ * @param {string&} name: 分发器名称，epoll、poll、select、io_uring（iouring）或 auto，不区分大小写
+ * @return {DispatcherType} 分发器类型
+ */
+DispatcherType DispatcherSelector::parse(const std::string& name) {
+	if (strcasecmp(name.data(), "poll") == 0) return DispatcherType::POLL;
+	else if (strcasecmp(name.data(), "select") == 0) return DispatcherType::SELECT;
+	else if (strcasecmp(name.data(), "io_uring") == 0 || strcasecmp(name.data(), "iouring") == 0) return DispatcherType::IOURING;
+	else if (strcasecmp(name.data(), "auto") == 0) return DispatcherType::AUTO;
+	return DispatcherType::EPOLL;
+}
+
+/** 
+ * @param {DispatcherType} type: 分发器类型
+ * @return {string} 分发器名称
+ */
+std::string DispatcherSelector::name(DispatcherType type) {
+	switch (type) {
+	case DispatcherType::POLL: return "poll";
+	case DispatcherType::SELECT: return "select";
+	case DispatcherType::IOURING: return "io_uring";
+	case DispatcherType::AUTO: return "auto";
+	default: return "epoll";
+	}
+}
+
+/** 
+ * @description: 用指定实现处理 pairs 个 socketpair，每轮向其中约 1/8 写入 1 字节，处理到全部读完为止
+ * @param {DispatcherType} type: 分发器类型
+ * @param {int} pairs: socketpair 数量
+ * @return {int64_t} 成功返回耗时（微秒）；失败返回 -1
+ */
+int64_t DispatcherSelector::measure(DispatcherType type, int pairs) {
+	const int rounds = 200;
+	int active = pairs / 8 > 0 ? pairs / 8 : 1;  // 每轮就绪的文件描述符数量
+	int received = 0;
+
+	EventLoop event_loop("Calibrate", type);
+	std::vector<int> writers;
+	std::vector<Probe*> probes;
+	for (int i = 0; i < pairs; ++i) {
+		int fds[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) == -1) {
+			break;
+		}
+		Probe* probe = new Probe;
+		probe->event_loop = &event_loop;
+		probe->received = &received;
+		probe->channel = new Channel(fds[0], FDEvent::READEVENT, probeRead, nullptr, probeDestroy, probe);
+		event_loop.addTask(probe->channel, ElemType::ADD);  // 所属线程添加任务时直接处理
+		probes.push_back(probe);
+		writers.push_back(fds[1]);
+	}
+
+	int64_t elapsed = -1;
+	if (static_cast<int>(writers.size()) == pairs) {
+		auto start = std::chrono::steady_clock::now();
+		int expected = 0;
+		int next = 0;
+		bool ok = true;
+		for (int round = 0; round < rounds && ok; ++round) {
+			for (int i = 0; i < active; ++i) {
+				char c = 0;
+				expected += write(writers[next], &c, 1) == 1 ? 1 : 0;
+				next = (next + 7) % pairs;  // 打散就绪的位置
+			}
+			int spins = 0;
+			while (received < expected && ok) {
+				event_loop.runOnce(100);
+				ok = ++spins < 1000;  // 实现不可用时避免卡住启动过程
+			}
+		}
+		if (ok) {
+			elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	for (auto probe : probes) {
+		event_loop.addTask(probe->channel, ElemType::DELETE);
+		delete probe;
+	}
+	for (int fd : writers) {
+		close(fd);
+	}
+	return elapsed;
+}
+
+/** 
+ * @description: 依次测试 epoll、poll、select（文件描述符不超过 FD_SETSIZE 时）和 io_uring（内核支持时），返回耗时最短的实现
+ * @param {int} expected_fds: 预计同时检测的文件描述符数量，受进程文件描述符上限约束
+ * @return {DispatcherType} 最快的分发器类型，全部失败时返回 EPOLL
+ */
+DispatcherType DispatcherSelector::calibrate(int expected_fds) {
+	// 每个 socketpair 占用两个文件描述符，预留一部分给监听套接字、日志文件等
+	struct rlimit limit;
+	int pairs = expected_fds > 0 ? expected_fds : 1;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+		int max_pairs = (static_cast<int>(limit.rlim_cur) - 64) / 2;
+		pairs = pairs < max_pairs ? pairs : max_pairs;
+	}
+	if (pairs <= 0) {
+		return DispatcherType::EPOLL;
+	}
+
+	std::vector<DispatcherType> candidates = { DispatcherType::EPOLL, DispatcherType::POLL };
+	if (pairs * 2 + 64 < FD_SETSIZE) {
+		candidates.push_back(DispatcherType::SELECT);
+	}
+	if (IoUringDispatcher::isSupported()) {
+		candidates.push_back(DispatcherType::IOURING);
+	}
+
+	DispatcherType best = DispatcherType::EPOLL;
+	int64_t best_time = -1;
+	std::string result = "dispatcher calibration (" + std::to_string(pairs) + " fds):";
+	for (auto type : candidates) {
+		int64_t elapsed = measure(type, pairs);
+		result += " " + name(type) + "=" + std::to_string(elapsed) + "us";
+		if (elapsed >= 0 && (best_time < 0 || elapsed < best_time)) {
+			best = type;
+			best_time = elapsed;
+		}
+	}
+	printf("%s, use %s\n", result.data(), name(best).data());  // 此时日志线程尚未启动
+	return best;
+}
@@ -14,25 +14,29 @@
 
 /** 
  * @description: 
- * @param {int} op: 委托 epoll 检测的事件，EPOLLIN 读事件、EPOLLOUT 写事件、EPOLLERR 异常事件
+ * @param {Channel*} channel: 封装文件描述符的 channel
+ * @param {int} op: 委托 epoll 检测的事件，EPOLLIN 读事件、EPOLLOUT 写事件、EPOLLERR 异常事件，EPOLLET 边沿触发
  * @return {int} 成功返回 0；失败返回 -1
  */
-int EpollDispatcher::epollCtl(int op) {
+int EpollDispatcher::epollCtl(Channel* channel, int op) {
 	// 获取对应事件
 	struct epoll_event ev;
-	ev.data.fd = m_channel->getSocket();  // 获取对应的文件描述符
+	ev.data.fd = channel->getSocket();  // 获取对应的文件描述符
 
 	int events = 0;
-	if (m_channel->getEvent() & static_cast<int>(FDEvent::READEVENT)) {  // 判断是否监听读事件
+	if (channel->getEvent() & static_cast<int>(FDEvent::READEVENT)) {  // 判断是否监听读事件
 		events |= EPOLLIN;
 	}
-	if (m_channel->getEvent() & static_cast<int>(FDEvent::WRITEEVENT)) {  // 判断是否监听写事件
+	if (channel->getEvent() & static_cast<int>(FDEvent::WRITEEVENT)) {  // 判断是否监听写事件
 		events |= EPOLLOUT;
 	}
+	if (channel->getEvent() & static_cast<int>(FDEvent::EDGETRIGGER)) {  // 判断是否为边沿触发
+		events |= EPOLLET;
+	}
 	ev.events = events;
 	
 	// 管理红黑树上的文件描述符(添加、删除、修改)
-	int ret = epoll_ctl(m_epfd, op, m_channel->getSocket(), &ev);
+	int ret = epoll_ctl(m_epfd, op, channel->getSocket(), &ev);
 	return ret;
 }
 
@@ -55,10 +59,11 @@ EpollDispatcher::~EpollDispatcher() {
 
 /** 
  * @description: 将文件描述符添加到 epfd 中，即添加到红黑树上
+ * @param {Channel*} channel: 封装文件描述符的 channel
  * @return {int} 成功返回 0；失败返回 -1
  */
-int EpollDispatcher::add() {
-	int ret = epollCtl(EPOLL_CTL_ADD);
+int EpollDispatcher::add(Channel* channel) {
+	int ret = epollCtl(channel, EPOLL_CTL_ADD);
 	if (ret == -1) {
 		perror("epoll_ctl add");
 		exit(0);
@@ -69,25 +74,25 @@ int EpollDispatcher::add() {
 
 /** 
  * @description: 将文件描述符从 epfd 中删除
+ * @param {Channel*} channel: 封装文件描述符的 channel
  * @return {int} 成功返回 0；失败返回 -1
  */
-int EpollDispatcher::remove() {
-	int ret = epollCtl(EPOLL_CTL_DEL);
+int EpollDispatcher::remove(Channel* channel) {
+	int ret = epollCtl(channel, EPOLL_CTL_DEL);
 	if (ret == -1) {
 		perror("epoll_ctl del");
 		exit(0);
 	}
-	// 通过 channel 释放对应的 TcpConnection 资源
-	m_channel->destroyCallback(const_cast<void*>(m_channel->getArg()));
 	return ret;
 }
 
 /** 
  * @description: 修改 epfd 中文件描述符的检测事件
+ * @param {Channel*} channel: 封装文件描述符的 channel
  * @return {int} 成功返回 0；失败返回 -1
  */
-int EpollDispatcher::modify() {
-	int ret = epollCtl(EPOLL_CTL_MOD);
+int EpollDispatcher::modify(Channel* channel) {
+	int ret = epollCtl(channel, EPOLL_CTL_MOD);
 	if (ret == -1) {
 		perror("epoll_ctl mod");
 		exit(0);
@@ -98,24 +103,23 @@ int EpollDispatcher::modify() {
 
 /** 
  * @description: 检测 epoll 实例中就绪的文件描述符，并执行相应操作
- * @param {int} timeout: 阻塞时长，0 不阻塞，大于 0 如果没有已就绪的文件描述符阻塞相应秒数后返回，-1 一直阻塞直至有已就绪的文件描述符
+ * @param {int} timeout: 阻塞时长，0 不阻塞，大于 0 如果没有已就绪的文件描述符阻塞相应毫秒数后返回，-1 一直阻塞直至有已就绪的文件描述符
  * @return {int} 成功检测到已就绪的文件描述符个数；函数超时阻塞被强制接触返回 0；失败返回 -1
  */
 int EpollDispatcher::dispatch(int timeout) {
 	// 检测就绪文件描述符 event 为传入传出参数，存储了已就绪的文件描述符信息，m_max_node 表示前者元素个数
-	int count = epoll_wait(m_epfd, m_events, m_max_node, timeout * 1000);
+	int count = epoll_wait(m_epfd, m_events, m_max_node, timeout);
 
 	// 处理就绪的文件描述符
 	for (int i = 0; i < count; ++i) {
+		if (i + 1 < count) {  // 处理当前事件时预取下一个就绪的 channel
+			m_event_loop->prefetchChannel(m_events[i + 1].data.fd);
+		}
 		int events = m_events[i].events;
 		int fd = m_events[i].data.fd;
-		// 如果出现异常直接将该文件描述符从 epoll 树删除
-		if (events & EPOLLERR || events & EPOLLHUP) {
-			// ERR 对端断开连接，HUP 对端断开连接后继续发送数据
-			remove();
-		}
-		// 处理对应读事件
-		if (events & EPOLLIN) {
+		// 处理对应读事件，出现异常时同样交给读事件处理（ERR 对端断开连接，HUP 对端断开连接后继续发送数据）
+		// 读取返回 0 或 -1 后由 TcpConnection 断开连接，不能在这里直接删除，此时并不知道 fd 对应的 channel
+		if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
 			m_event_loop->eventActive(fd, (int)FDEvent::READEVENT);
 		}
 		// 处理对应写事件
@@ -0,0 +1,355 @@
+/** 
+ * @author: yuyuyuj1e 807152541@qq.com
+ * @github: https://github.com/yuyuyuj1e
+ * @csdn: https://blog.csdn.net/yuyuyuj1e
+ * @date: 2023-03-20 10:12:41
+ * @last_edit_time: 2023-03-20 10:12:41
+ * @file_path: /CC/src/Dispatcher/IoUringDispatcher.cpp
+ * @description: IoUringDispatcher 源文件
+ */
+
+#include "Dispatcher.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include "IoUringDispatcher.h"
+
+// 特殊的 user_data，用于区分非 poll 请求的完成事件
+static const unsigned long long TIMEOUT_DATA = ~0ULL;
+static const unsigned long long REMOVE_DATA = ~0ULL - 1;
+
+/**
+ * @description: 将文件描述符和请求代数打包为 user_data
+ */
+static inline unsigned long long packData(int fd, unsigned int generation) {
+	return (static_cast<unsigned long long>(generation) << 32) | static_cast<unsigned int>(fd);
+}
+
+/** 
+ * @description: 尝试创建一个最小的 io_uring 实例，内核版本过低或者被 seccomp 禁用时失败
+ * @return {bool} 可以使用返回 true
+ */
+bool IoUringDispatcher::isSupported() {
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	int fd = syscall(__NR_io_uring_setup, 2, &params);
+	if (fd == -1) {
+		return false;
+	}
+	close(fd);
+	return true;
+}
+
+IoUringDispatcher::IoUringDispatcher(EventLoop* event_loop) : Dispatcher(event_loop) {
+	// 创建 io_uring 实例
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	m_ring_fd = syscall(__NR_io_uring_setup, m_max_node, &params);
+	if (m_ring_fd == -1) {
+		perror("io_uring_setup");
+		exit(0);
+	}
+
+	// 映射提交队列和完成队列，内核支持 SINGLE_MMAP 时两者共用一块内存
+	m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+	if (single_mmap) {
+		m_sq_size = m_cq_size = m_sq_size > m_cq_size ? m_sq_size : m_cq_size;
+	}
+	m_sq_ptr = mmap(NULL, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+	if (m_sq_ptr == MAP_FAILED) {
+		perror("mmap sq ring");
+		exit(0);
+	}
+	m_cq_ptr = m_sq_ptr;
+	if (!single_mmap) {
+		m_cq_ptr = mmap(NULL, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+		if (m_cq_ptr == MAP_FAILED) {
+			perror("mmap cq ring");
+			exit(0);
+		}
+	}
+	m_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	m_sqes = static_cast<struct io_uring_sqe*>(mmap(NULL, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES));
+	if (m_sqes == MAP_FAILED) {
+		perror("mmap sqes");
+		exit(0);
+	}
+
+	// 记录队列各个字段的地址
+	char* sq = static_cast<char*>(m_sq_ptr);
+	m_sq_head = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+	m_sq_tail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+	m_sq_mask = reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+	m_sq_array = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+	char* cq = static_cast<char*>(m_cq_ptr);
+	m_cq_head = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+	m_cq_tail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+	m_cq_mask = reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+	m_cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+	m_to_submit = 0;
+	m_name = "IoUring";
+}
+
+IoUringDispatcher::~IoUringDispatcher() {
+	munmap(m_sqes, m_sqes_size);
+	if (m_cq_ptr != m_sq_ptr) {
+		munmap(m_cq_ptr, m_cq_size);
+	}
+	munmap(m_sq_ptr, m_sq_size);
+	close(m_ring_fd);
+}
+
+/**
+ * @description: 获取一个空闲的提交队列项，提交队列已满时先将已有请求提交给内核
+ * @description: 内核取走请求后才会推进 head，提交失败或者没有全部取走时重新读取 head 判断，不能覆盖尚未提交的请求
+ * @return {io_uring_sqe*} 已清零的提交队列项；提交队列仍然已满返回 nullptr
+ */
+struct io_uring_sqe* IoUringDispatcher::getSqe() {
+	unsigned int head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+	unsigned int tail = *m_sq_tail;
+	if (tail - head >= m_max_node) {
+		int ret = 0;
+		do {
+			ret = submit(0);
+		} while (ret == -1 && errno == EINTR);
+		head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+		if (tail - head >= m_max_node) {
+			perror("io_uring_enter");
+			return nullptr;
+		}
+	}
+
+	unsigned int index = tail & *m_sq_mask;
+	struct io_uring_sqe* sqe = &m_sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	m_sq_array[index] = index;
+	__atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);  // 内核读取 tail 时能看到完整的请求
+	++m_to_submit;
+	return sqe;
+}
+
+/**
+ * @description: 提交已写入的请求，并等待完成事件
+ * @param {unsigned int} wait_nr: 需要等待的完成事件数量，0 表示只提交不等待
+ * @return {int} 成功返回提交的请求数量；失败返回 -1
+ */
+int IoUringDispatcher::submit(unsigned int wait_nr) {
+	unsigned int flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+	int ret = syscall(__NR_io_uring_enter, m_ring_fd, m_to_submit, wait_nr, flags, NULL, 0);
+	if (ret >= 0) {
+		m_to_submit -= ret;
+	}
+	return ret;
+}
+
+/**
+ * @description: 根据 channel 检测的事件计算 poll 事件，总是包含 POLLERR 与 POLLHUP（poll 本来就会报告），读写事件都不检测时结果也不为 0，0 表示没有注册
+ * @param {Channel*} channel: 封装文件描述符的 channel
+ * @return {unsigned int} poll 事件
+ */
+unsigned int IoUringDispatcher::pollMask(Channel* channel) {
+	unsigned int mask = POLLERR | POLLHUP;
+	if (channel->getEvent() & static_cast<int>(FDEvent::READEVENT)) {  // 判断是否监听读事件
+		mask |= POLLIN;
+	}
+	if (channel->getEvent() & static_cast<int>(FDEvent::WRITEEVENT)) {  // 判断是否监听写事件
+		mask |= POLLOUT;
+	}
+	return mask;
+}
+
+/**
+ * @description: 提交 poll 请求，multishot 请求会一直有效，直至被撤销或出错
+ * @description: 提交队列已满且无法提交时记录下来，下一次 dispatch 时重新提交
+ * @param {int} fd: 文件描述符
+ * @param {unsigned int} mask: poll 事件
+ * @param {bool} multishot: 是否为 multishot 请求
+ */
+void IoUringDispatcher::pollAdd(int fd, unsigned int mask, bool multishot) {
+	if (fd >= static_cast<int>(m_polls.size())) {
+		m_polls.resize(fd + 1);
+	}
+	PollState& state = m_polls[fd];
+	++state.generation;
+	state.mask = mask;
+	state.multishot = multishot;
+
+	struct io_uring_sqe* sqe = getSqe();
+	if (sqe == nullptr) {
+		m_retry.push_back(fd);
+		return;
+	}
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll32_events = mask;
+	sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+	sqe->user_data = packData(fd, state.generation);
+}
+
+/**
+ * @description: 撤销 fd 对应的 poll 请求，并使该请求尚未处理的完成事件失效（之后的完成事件会因为代数不同而被丢弃）
+ * @param {int} fd: 文件描述符
+ */
+void IoUringDispatcher::pollRemove(int fd) {
+	PollState& state = m_polls[fd];
+	pollCancel(packData(fd, state.generation));
+	++state.generation;
+	state.mask = 0;
+}
+
+/**
+ * @description: 写入撤销请求，提交队列已满时记录下来，下一次 dispatch 时重新写入
+ * @description: 撤销请求提交之前内核中的 poll 请求仍然持有文件的引用，因此不能丢弃，否则关闭的套接字一直不会真正释放
+ * @param {unsigned long long} data: 被撤销的 poll 请求的 user_data
+ */
+void IoUringDispatcher::pollCancel(unsigned long long data) {
+	struct io_uring_sqe* sqe = getSqe();
+	if (sqe == nullptr) {
+		m_retry_remove.push_back(data);
+		return;
+	}
+	sqe->opcode = IORING_OP_POLL_REMOVE;
+	sqe->fd = -1;
+	sqe->addr = data;
+	sqe->user_data = REMOVE_DATA;
+}
+
+/**
+ * @description: 为文件描述符提交 poll 请求，请求在下一次 dispatch 时统一提交
+ * @param {Channel*} channel: 封装文件描述符的 channel
+ * @return {int} 成功返回 0；失败返回 -1
+ */
+int IoUringDispatcher::add(Channel* channel) {
+	int fd = channel->getSocket();
+	if (fd < static_cast<int>(m_polls.size()) && m_polls[fd].mask != 0) {
+		return -1;  // 已经注册过
+	}
+	pollAdd(fd, pollMask(channel), channel->isEdgeTrigger());
+	return 0;
+}
+
+/**
+ * @description: 撤销文件描述符的 poll 请求，撤销请求与其他请求一样在下一次 dispatch 时统一提交，关闭连接不会多一次系统调用
+ * @description: 随后文件描述符被关闭，套接字在撤销请求提交后才真正释放；在此之前即使 fd 被复用，旧请求的完成事件也会因为代数不同而被丢弃
+ * @param {Channel*} channel: 封装文件描述符的 channel
+ * @return {int} 成功返回 0；失败返回 -1
+ */
+int IoUringDispatcher::remove(Channel* channel) {
+	int fd = channel->getSocket();
+	int ret = -1;
+	if (fd < static_cast<int>(m_polls.size()) && m_polls[fd].mask != 0) {
+		pollRemove(fd);
+		ret = 0;
+	}
+	return ret;
+}
+
+/**
+ * @description: 修改文件描述符的检测事件，撤销旧请求后重新提交
+ * @description: 边沿触发时即使检测事件没有变化也重新提交，与 EPOLL_CTL_MOD 一样重新检测当前状态，用完预算但仍然可读写的套接字依靠它再次得到通知
+ * @param {Channel*} channel: 封装文件描述符的 channel
+ * @return {int} 成功返回 0；失败返回 -1
+ */
+int IoUringDispatcher::modify(Channel* channel) {
+	int fd = channel->getSocket();
+	if (fd >= static_cast<int>(m_polls.size()) || m_polls[fd].mask == 0) {
+		return -1;
+	}
+	unsigned int mask = pollMask(channel);
+	if (mask == m_polls[fd].mask && !m_polls[fd].multishot) {
+		return 0;  // 检测事件没有变化
+	}
+	pollRemove(fd);
+	pollAdd(fd, mask, channel->isEdgeTrigger());
+	return 0;
+}
+
+/**
+ * @description: 提交所有积压的请求，等待并批量处理完成事件
+ * @param {int} timeout: 阻塞时长，0 不阻塞，大于 0 如果没有已就绪的文件描述符阻塞相应毫秒数后返回，-1 一直阻塞直至有已就绪的文件描述符
+ * @return {int} 成功返回处理的就绪事件个数；失败返回 -1
+ */
+int IoUringDispatcher::dispatch(int timeout) {
+	// 重新提交之前因为提交队列已满而没能提交的撤销请求与 poll 请求
+	std::vector<unsigned long long> retry_remove;
+	retry_remove.swap(m_retry_remove);
+	for (unsigned long long data : retry_remove) {
+		pollCancel(data);
+	}
+	std::vector<int> retry;
+	retry.swap(m_retry);
+	for (int fd : retry) {
+		if (m_polls[fd].mask != 0) {
+			pollAdd(fd, m_polls[fd].mask, m_polls[fd].multishot);
+		}
+	}
+
+	// 超时请求在出现 1 个完成事件或者超时后结束，这样等待完成事件时不会超过 timeout
+	unsigned int wait_nr = timeout == 0 ? 0 : 1;
+	if (timeout > 0) {
+		m_timeout.tv_sec = timeout / 1000;
+		m_timeout.tv_nsec = timeout % 1000 * 1000000LL;
+		struct io_uring_sqe* sqe = getSqe();
+		if (sqe == nullptr) {  // 无法提交超时请求时不等待，避免一直阻塞
+			wait_nr = 0;
+		}
+		else {
+			sqe->opcode = IORING_OP_TIMEOUT;
+			sqe->fd = -1;
+			sqe->addr = reinterpret_cast<unsigned long long>(&m_timeout);
+			sqe->len = 1;
+			sqe->off = 1;
+			sqe->user_data = TIMEOUT_DATA;
+		}
+	}
+
+	// 一次系统调用完成提交和等待
+	int ret = submit(wait_nr);
+	if (ret == -1 && errno != EINTR && errno != EBUSY) {
+		perror("io_uring_enter");
+		exit(0);
+	}
+
+	// 处理完成事件，回调中可能会继续写入提交队列，但不会影响完成队列
+	int count = 0;
+	unsigned int head = *m_cq_head;
+	while (head != __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE)) {
+		struct io_uring_cqe cqe = m_cqes[head & *m_cq_mask];
+		++head;
+		__atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);  // 及时归还完成队列项
+		if (head != *m_cq_tail) {  // 处理当前事件时预取下一个就绪的 channel
+			m_event_loop->prefetchChannel(static_cast<int>(m_cqes[head & *m_cq_mask].user_data & 0xffffffff));
+		}
+
+		if (cqe.user_data == TIMEOUT_DATA || cqe.user_data == REMOVE_DATA) {
+			continue;
+		}
+		int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+		unsigned int generation = static_cast<unsigned int>(cqe.user_data >> 32);
+		if (fd >= static_cast<int>(m_polls.size()) || m_polls[fd].generation != generation || m_polls[fd].mask == 0) {
+			continue;  // 已经撤销或者重新注册过的请求
+		}
+		if (cqe.res >= 0) {
+			++count;
+			// 异常事件交给读事件处理，读回调读取失败后会断开连接
+			if (cqe.res & (POLLIN | POLLERR | POLLHUP)) {
+				m_event_loop->eventActive(fd, (int)FDEvent::READEVENT);
+			}
+			// 读回调中可能已经撤销了该文件描述符
+			if (cqe.res & POLLOUT && m_polls[fd].generation == generation) {
+				m_event_loop->eventActive(fd, (int)FDEvent::WRITEEVENT);
+			}
+		}
+		// 没有 MORE 标志说明请求已经结束（单次请求，或者 multishot 请求出错），如果仍需检测则重新提交
+		if (!(cqe.flags & IORING_CQE_F_MORE) && m_polls[fd].generation == generation && m_polls[fd].mask != 0) {
+			pollAdd(fd, m_polls[fd].mask, m_polls[fd].multishot);
+		}
+	}
+	return count;
+}
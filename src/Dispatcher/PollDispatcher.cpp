@@ -14,72 +14,96 @@
 #include "PollDispatcher.h"
 
 PollDispatcher::PollDispatcher(EventLoop* event_loop) : Dispatcher(event_loop) {
-	m_max_fd_sub = 0;
-	m_fds = new struct pollfd[m_max_node];
-	for (int i = 0; i < m_max_node; ++i) {
-		m_fds[i].fd = -1;
-		m_fds[i].events = 0;
-		m_fds[i].revents = 0;
-	}
+	m_fds.reserve(1024);
+	m_slots.assign(1024, -1);
 	m_name = "Poll";
 }
 
 PollDispatcher::~PollDispatcher() {
-	delete[] m_fds;
 }
 
 /** 
- * @description: 将文件描述符添加到待检测集合中
- * @return {int} 成功返回 0；失败返回 -1
+ * @description: 根据 channel 检测的事件计算 poll 事件
+ * @param {Channel*} channel: 封装文件描述符的 channel
+ * @return {short} poll 事件
  */
-int PollDispatcher::add() {
-	// 获取对应事件
-	int events = 0;
-	if (m_channel->getEvent() & static_cast<int>(FDEvent::READEVENT)) {  // 判断是否监听读事件
+short PollDispatcher::pollEvents(Channel* channel) {
+	short events = 0;
+	if (channel->getEvent() & static_cast<int>(FDEvent::READEVENT)) {  // 判断是否监听读事件
 		events |= POLLIN;
 	}
-	if (m_channel->getEvent() & static_cast<int>(FDEvent::WRITEEVENT)) {  // 判断是否监听写事件
+	if (channel->getEvent() & static_cast<int>(FDEvent::WRITEEVENT)) {  // 判断是否监听写事件
 		events |= POLLOUT;
 	}
+	return events;
+}
 
-	// 找到空闲的位置放置 fd
-	int i = 0;
-	for (; i < m_max_node; ++i) {
-		if (m_fds[i].fd == -1) {
-			m_fds[i].fd = m_channel->getSocket();
-			m_fds[i].events = events;
-			m_max_fd_sub = i > m_max_fd_sub ? i : m_max_fd_sub;  // 更新最大有效下标
-			break;
-		}
+/** 
+ * @description: 查找文件描述符在 m_fds 中的位置
+ * @param {int} fd: 文件描述符
+ * @return {int} 成功返回下标；不在检测集合中返回 -1
+ */
+int PollDispatcher::findSlot(int fd) {
+	if (fd < 0 || fd >= static_cast<int>(m_slots.size())) {
+		return -1;
 	}
+	return m_slots[fd];
+}
 
-	// 如果没有空闲位置，添加文件描述符失败，返回 -1
-	if (i >= m_max_node) {
+/** 
+ * @description: 将文件描述符添加到待检测集合中，直接放在数组末尾
+ * @param {Channel*} channel: 封装文件描述符的 channel
+ * @return {int} 成功返回 0；失败返回 -1
+ */
+int PollDispatcher::add(Channel* channel) {
+	int fd = channel->getSocket();
+	if (fd < 0) {
 		return -1;
 	}
+	int slot = findSlot(fd);
+	if (slot != -1) {  // 已经在检测集合中，更新检测事件
+		m_fds[slot].events = pollEvents(channel);
+		return 0;
+	}
 
+	// 索引表不够大时扩容
+	if (fd >= static_cast<int>(m_slots.size())) {
+		size_t size = m_slots.size();
+		while (static_cast<int>(size) <= fd) {
+			size *= 2;
+		}
+		m_slots.resize(size, -1);
+	}
+
+	struct pollfd item;
+	item.fd = fd;
+	item.events = pollEvents(channel);
+	item.revents = 0;
+	m_fds.push_back(item);
+	m_slots[fd] = static_cast<int>(m_fds.size()) - 1;
 	return 0;
 }
 
 /** 
- * @description: 将文件描述符从待检测集合中删除
+ * @description: 将文件描述符从待检测集合中删除，将最后一个元素移到空出的位置，保持数组紧凑
+ * @param {Channel*} channel: 封装文件描述符的 channel
  * @return {int} 成功返回 0；失败返回 -1
  */
-int PollDispatcher::remove() {
-	int i = 0;
-	for (; i < m_max_node; ++i) {
-		if (m_fds[i].fd == m_channel->getSocket()) {
-			m_fds[i].fd = -1;
-			m_fds[i].events = 0;
-			m_fds[i].revents = 0;
-			break;
+int PollDispatcher::remove(Channel* channel) {
+	int fd = channel->getSocket();
+	int slot = findSlot(fd);
+	if (slot != -1) {
+		int last = static_cast<int>(m_fds.size()) - 1;
+		if (slot != last) {
+			m_fds[slot] = m_fds[last];
+			m_slots[m_fds[slot].fd] = slot;
 		}
+		m_fds.pop_back();
+		m_slots[fd] = -1;
 	}
-	// 通过 channel 释放对应的 TcpConnection 资源
-	m_channel->destroyCallback(const_cast<void*>(m_channel->getArg()));
 
 	// 未找到对应文件描述符
-	if (i >= m_max_node) {
+	if (slot == -1) {
 		return -1;
 	}
 
@@ -88,61 +112,53 @@ int PollDispatcher::remove() {
 
 /** 
  * @description: 修改待检测集合中的文件描述符的检测事件
+ * @param {Channel*} channel: 封装文件描述符的 channel
  * @return {int} 成功返回 0；失败返回 -1
  */
-int PollDispatcher::modify() {
-	// 获取对应事件
-	int events = 0;
-	if (m_channel->getEvent() & static_cast<int>(FDEvent::READEVENT)) {  // 判断是否监听读事件
-		events |= POLLIN;
-	}
-	if (m_channel->getEvent() & static_cast<int>(FDEvent::WRITEEVENT)) {  // 判断是否监听写事件
-		events |= POLLOUT;
-	}
-
-	// 找到对应文件描述符
-	int i = 0;
-	for (; i < m_max_node; ++i) {
-		if (m_fds[i].fd == m_channel->getSocket()) {
-			m_fds[i].events = events;
-			break;
-		}
-	}
-
-	// 为找到文件描述符，返回 -1
-	if (i >= m_max_node) {
+int PollDispatcher::modify(Channel* channel) {
+	int slot = findSlot(channel->getSocket());
+	if (slot == -1) {  // 未找到文件描述符，返回 -1
 		return -1;
 	}
-
+	m_fds[slot].events = pollEvents(channel);
 	return 0;
 }
 
 
 /** 
  * @description: 检测 poll 实例中就绪的文件描述符，并执行相应操作
- * @param {int} timeout: 阻塞时长，0 不阻塞检测集合中没有就绪文件描述符立马返回，大于 0 如果没有已就绪的文件描述符阻塞相应秒数后返回，-1 一直阻塞直至有已就绪的文件描述符
+ * @param {int} timeout: 阻塞时长，0 不阻塞检测集合中没有就绪文件描述符立马返回，大于 0 如果没有已就绪的文件描述符阻塞相应毫秒数后返回，-1 一直阻塞直至有已就绪的文件描述符
  * @return {int} 失败返回 -1，成功返回检测集合中就绪的文件描述符个数
  */
 int PollDispatcher::dispatch(int timeout) {
 	// poll 失败返回 -1，成功返回检测集合中就绪的文件描述符个数
-	int count = poll(m_fds, m_max_fd_sub + 1, timeout * 1000);
+	int count = poll(m_fds.data(), m_fds.size(), timeout);
 	if (count == -1) {
 		perror("poll");
 		exit(0);
 	}
 
-	// 处理激活的文件描述符
-	for (int i = 0; i < m_max_fd_sub + 1; ++i) {
-		if (m_fds[i].fd == -1) {
-			continue;
+	// 先复制就绪的文件描述符，找齐 count 个后不再继续遍历
+	m_ready.clear();
+	for (size_t i = 0; i < m_fds.size() && static_cast<int>(m_ready.size()) < count; ++i) {
+		if (m_fds[i].revents != 0) {
+			m_ready.push_back(m_fds[i]);
+		}
+	}
+
+	// 处理激活的文件描述符，回调中可能添加或删除文件描述符，因此不能直接遍历 m_fds
+	for (size_t i = 0; i < m_ready.size(); ++i) {
+		int fd = m_ready[i].fd;
+		if (i + 1 < m_ready.size()) {
+			m_event_loop->prefetchChannel(m_ready[i + 1].fd);
 		}
-		// 处理对应读事件
-		if (m_fds[i].revents & POLLIN) {
-			m_event_loop->eventActive(m_fds[i].fd, (int)FDEvent::READEVENT);
+		// 处理对应读事件，出错或对端关闭时同样交给读事件处理（读取返回 0 或 -1 后断开连接）
+		if (m_ready[i].revents & (POLLIN | POLLERR | POLLHUP)) {
+			m_event_loop->eventActive(fd, (int)FDEvent::READEVENT);
 		}
-		// 处理对应写事件
-		if (m_fds[i].revents & POLLOUT) {
-			m_event_loop->eventActive(m_fds[i].fd, (int)FDEvent::WRITEEVENT);
+		// 处理对应写事件，读事件中连接可能已经被释放，此时 fd 已不在检测集合中
+		if ((m_ready[i].revents & POLLOUT) && findSlot(fd) != -1) {
+			m_event_loop->eventActive(fd, (int)FDEvent::WRITEEVENT);
 		}
 	}
 
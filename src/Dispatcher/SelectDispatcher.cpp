@@ -16,25 +16,27 @@
 
 /** 
  * @description: 将文件描述符添加到对应的检测集合中
+ * @param {Channel*} channel: 封装文件描述符的 channel
  */
-void SelectDispatcher::setFdSet() {
-	if (m_channel->getEvent() & static_cast<int>(FDEvent::READEVENT)) {  // 判断是否监听读事件
-		FD_SET(m_channel->getSocket(), &m_read_set);
+void SelectDispatcher::setFdSet(Channel* channel) {
+	if (channel->getEvent() & static_cast<int>(FDEvent::READEVENT)) {  // 判断是否监听读事件
+		FD_SET(channel->getSocket(), &m_read_set);
 	}
-	if (m_channel->getEvent() & static_cast<int>(FDEvent::WRITEEVENT)) {  // 判断是否监听写事件
-		FD_SET(m_channel->getSocket(), &m_write_set);
+	if (channel->getEvent() & static_cast<int>(FDEvent::WRITEEVENT)) {  // 判断是否监听写事件
+		FD_SET(channel->getSocket(), &m_write_set);
 	}
 }
 
 /** 
  * @description: 将文件描述符从对应文件描述符中移除
+ * @param {Channel*} channel: 封装文件描述符的 channel
  */
-void SelectDispatcher::clearFdSet() {
-	if (m_channel->getEvent() & static_cast<int>(FDEvent::READEVENT)) {  // 判断是否监听读事件
-		FD_CLR(m_channel->getSocket(), &m_read_set);
+void SelectDispatcher::clearFdSet(Channel* channel) {
+	if (channel->getEvent() & static_cast<int>(FDEvent::READEVENT)) {  // 判断是否监听读事件
+		FD_CLR(channel->getSocket(), &m_read_set);
 	}
-	if (m_channel->getEvent() & static_cast<int>(FDEvent::WRITEEVENT)) {  // 判断是否监听写事件
-		FD_CLR(m_channel->getSocket(), &m_write_set);
+	if (channel->getEvent() & static_cast<int>(FDEvent::WRITEEVENT)) {  // 判断是否监听写事件
+		FD_CLR(channel->getSocket(), &m_write_set);
 	}
 }
 
@@ -48,55 +50,58 @@ SelectDispatcher::SelectDispatcher(EventLoop* event_loop) : Dispatcher(event_loo
 
 /** 
  * @description: 将文件描述符添加到对应检测集合中
+ * @param {Channel*} channel: 封装文件描述符的 channel
  * @return {int} 成功返回 0；失败返回 -1
  */
-int SelectDispatcher::add() {
-	if (m_channel->getSocket() >= m_max_size) {
+int SelectDispatcher::add(Channel* channel) {
+	if (channel->getSocket() >= m_max_size) {
 		return -1;
 	}
 
 	// 添加对应事件
-	setFdSet();
+	setFdSet(channel);
 	return 0;
 }
 
 /** 
  * @description: 将文件描述符从对应检测集合中移除
+ * @param {Channel*} channel: 封装文件描述符的 channel
  * @return {int} 成功返回 0；失败返回 -1
  */
-int SelectDispatcher::remove() {
-	if (m_channel->getSocket() >= m_max_size) {
+int SelectDispatcher::remove(Channel* channel) {
+	if (channel->getSocket() >= m_max_size) {
 		return -1;
 	}
 
 	// 移除对应文件描述符
-	clearFdSet();
+	clearFdSet(channel);
 
-	// 通过 channel 释放对应的 TcpConnection 资源
-	m_channel->destroyCallback(const_cast<void*>(m_channel->getArg()));
 	return 0;
 }
 
 /** 
  * @description: 修改检测集合中的文件描述符
+ * @param {Channel*} channel: 封装文件描述符的 channel
  * @return {int} 成功返回 0；失败返回 -1
  */
-int SelectDispatcher::modify() {
-	setFdSet();
-	clearFdSet();
+int SelectDispatcher::modify(Channel* channel) {
+	// 先从两个集合中都移除，再按照新的检测事件添加
+	FD_CLR(channel->getSocket(), &m_read_set);
+	FD_CLR(channel->getSocket(), &m_write_set);
+	setFdSet(channel);
 	return 0;
 }
 
 /** 
  * @description: 检测 select 实例中就绪的文件描述符，并执行相应操作
- * @param {int} timeout: 阻塞时长，0 不阻塞检测集合中没有就绪文件描述符立马返回，大于 0 如果没有已就绪的文件描述符阻塞相应秒数后返回，-1 一直阻塞直至有已就绪的文件描述符
+ * @param {int} timeout: 阻塞时长，0 不阻塞检测集合中没有就绪文件描述符立马返回，大于 0 如果没有已就绪的文件描述符阻塞相应毫秒数后返回，-1 一直阻塞直至有已就绪的文件描述符
  * @return {int} 成功，返回集合中已就绪文件描述符总个数；失败返回 -1；超时，没有检测到就绪的文件描述符，返回 0
  */
 int SelectDispatcher::dispatch(int timeout) {
 	// 将 timeval 设置为 NULL 表示检测不到文件描述符就一直阻塞；固定时长表示指定阻塞指定长度；0 不阻塞
 	struct timeval val;
-	val.tv_sec = timeout;
-	val.tv_usec = 0;
+	val.tv_sec = timeout / 1000;
+	val.tv_usec = timeout % 1000 * 1000;
 	fd_set rdtmp = m_read_set;
 	fd_set wrtmp = m_write_set;
 	int count = 0;
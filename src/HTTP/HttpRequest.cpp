@@ -15,6 +15,7 @@
 #include <unistd.h>
 #include "TcpConnection.h"
 #include <string.h>
+#include <stdlib.h>
 #include <iostream>
 
 HttpRequest::HttpRequest() {
@@ -31,43 +32,74 @@ void HttpRequest::reset() {
     m_url = std::string();
     m_version = std::string();
     m_reqquest_headers.clear();
+    m_reqquest_body.clear();
+    m_scan_offset = 0;
+    m_header_size = 0;
+    m_content_length = 0;
 }
 
 /** 
- * @description: 外部调用该函数解析 HTTP 请求
+ * @description: 外部调用该函数解析 HTTP 请求，每次只解析一个请求，之后的数据留在 read_buffer 中，由调用者决定是否继续解析（流水线）
+ * @description: 请求可能分多次到达，数据不完整时保留解析状态并返回 AGAIN，收到更多数据后再次调用，从中断的位置继续
  * @param {Buffer*} read_buffer: 存放请求数据的缓冲区
  * @param {HttpResponse*} response: 组织回复数据的对象指针
  * @param {Buffer*} send_buffer: 发送数据的缓冲区
- * @param {int} cfd: 通信文件描述符
- * @return {bool} 解析成功返回 true，解析失败返回 false
+ * @return {ParseResult} 请求处理完毕返回 COMPLETE；数据不完整返回 AGAIN；请求格式错误、超出长度限制或者不支持返回 ERROR
  */
-bool HttpRequest::parseRequest(Buffer* read_buffer, HttpResponse* response, Buffer* send_buffer, int cfd) {
-    bool flag = true;
+ParseResult HttpRequest::parseRequest(Buffer* read_buffer, HttpResponse* response, Buffer* send_buffer) {
+    ParseResult result = ParseResult::COMPLETE;
     // 循环条件——请求数据尚未处理完毕，且前序处理都成功
-    while (m_cur_state != PrecessState::DONE && flag == true) {
+    while (m_cur_state != PrecessState::DONE && result == ParseResult::COMPLETE) {
         switch (m_cur_state) {
         case PrecessState::LINE:  // 处理请求行
-            flag = parseLine(read_buffer);
+            result = parseLine(read_buffer);
             break;
         case PrecessState::HEADERS:  // 处理请求头
-            flag = parseHeader(read_buffer);
+            result = parseHeader(read_buffer);
             break;
-        case PrecessState::BODY:  // 处理 POST 发送的数据
-            flag = parseBody(read_buffer);
+        case PrecessState::BODY:  // 处理请求体
+            result = parseBody(read_buffer);
             break;
         default:
             break;
         }
     }
 
+    if (result == ParseResult::AGAIN) {
+        return result;  // 已经解析的部分保存在对象中，不能重置
+    }
+
     // 如果解析完毕, 准备回复的数据
-    if (m_cur_state == PrecessState::DONE) {
-        processRequest(response);  // 1. 根据解析出的原始数据, 对客户端的请求做出处理
-        response->prepareHeadMsg(send_buffer, cfd);  // 2. 组织响应头数据并发送给客户端
+    if (result == ParseResult::COMPLETE) {
+        // 长连接：调用者通过 response 给出是否允许保持连接，再结合客户端的 Connection 请求头决定
+        // HTTP/1.1 默认保持连接，除非指定 Connection: close；HTTP/1.0 只有指定 Connection: keep-alive 时才保持
+        std::string connection = getHeader("Connection", &m_reqquest_headers);
+        bool keep_alive = strcasecmp(m_version.data(), "HTTP/1.1") == 0 ? strcasecmp(connection.data(), "close") != 0 : strcasecmp(connection.data(), "keep-alive") == 0;
+        response->setKeepAlive(response->isKeepAlive() && keep_alive);
+
+        if (!processRequest(response)) {  // 1. 根据解析出的原始数据, 对客户端的请求做出处理，不支持的请求方式按照解析失败处理
+            result = ParseResult::ERROR;
+        }
+        else if (!response->isBodyPending()) {
+            response->prepareHeadMsg(send_buffer);  // 2. 组织响应头数据写入发送缓冲区，需要生成的响应体在生成后才知道长度，由 TcpConnection 组织响应头
+        }
     }
 
     reset();   // 请求处理完毕，还原初始状态, 保证还能继续处理第二条及以后的请求
-    return flag;
+    return result;
+}
+
+/** 
+ * @description: 查找当前行的结束位置，从上次查找结束的位置继续，已经查找过的数据不会重复扫描
+ * @param {Buffer*} read_buffer: 存放请求数据的缓冲区
+ * @return {char*} 找到返回 \r\n 的起始位置；数据不完整返回 nullptr
+ */
+char* HttpRequest::findLineEnd(Buffer* read_buffer) {
+    int size = read_buffer->readableSize();
+    char* end = static_cast<char*>(memmem(read_buffer->readPos() + m_scan_offset, size - m_scan_offset, "\r\n", 2));
+    // 没有找到时最后一个字节可能是 \r，下次从它开始查找；找到时该行会被取出，下一行从头开始查找
+    m_scan_offset = end == nullptr ? (size > 0 ? size - 1 : 0) : 0;
+    return end;
 }
 
 /** 
@@ -76,13 +108,13 @@ bool HttpRequest::parseRequest(Buffer* read_buffer, HttpResponse* response, Buff
  * @param {char*} end: 字符串结束位置
  * @param {char*} stop_str: 结束的字串，请求行的格式一般为  GET xxx/xxx.jgp HTTP1.1，因此 stop_str 可以是空格
  * @param {function<void(std::string)>} callback: 用于设置的回调函数
- * @return {char*} 指向处理过后的下一个位置的指针
+ * @return {char*} 指向处理过后的下一个位置的指针；没有找到停止子串返回 nullptr
  */
 char* HttpRequest::splitLine(const char* start, const char* end, const char* stop_str, std::function<void(std::string)> callback) {
     // 如果设置了停止子串 space = 停止子串的起始位置，否则的话是字符串的最后一个位置
     char* space = stop_str == nullptr ? const_cast<char*>(end) : static_cast<char*>(memmem(start, end - start, stop_str, strlen(stop_str)));
     if (space == nullptr) {
-        perror("split line");
+        return nullptr;
     }
 
     int length = space - start;
@@ -93,30 +125,47 @@ char* HttpRequest::splitLine(const char* start, const char* end, const char* sto
 /** 
  * @description: 处理请求行数据
  * @param {Buffer*} read_buffer: 存放请求数据的缓冲区
- * @return {bool} 解析成功返回 true，解析失败返回 false
+ * @return {ParseResult} 解析成功返回 COMPLETE；请求行不完整返回 AGAIN；格式错误或者超出长度限制返回 ERROR
  */
-bool HttpRequest::parseLine(Buffer* read_buffer) {
-    char* end = read_buffer->findCRLF();  // 请求行结束地址
+ParseResult HttpRequest::parseLine(Buffer* read_buffer) {
+    char* end = findLineEnd(read_buffer);  // 请求行结束地址
     if (end == nullptr) {
-        return false;
+        // 请求行不完整，超出长度限制时不再等待
+        return read_buffer->readableSize() > m_max_line_size ? ParseResult::ERROR : ParseResult::AGAIN;
     }
     char* start = read_buffer->readPos();  // 请求行起始地址
     int line_size = end - start;  // 请求行总长度
+    if (line_size == 0) {  // 请求之间多余的空行（如 POST 请求体后的 \r\n）直接跳过
+        read_buffer->readPosIncrease(2);
+        return ParseResult::COMPLETE;
+    }
+    if (line_size > m_max_line_size) {
+        return ParseResult::ERROR;
+    }
 
     // 解析 method 并存储
     auto methodFunc = std::bind(&HttpRequest::setMethod, this, std::placeholders::_1);
     start = splitLine(start, end, " ", methodFunc);
+    if (start == nullptr) {
+        return ParseResult::ERROR;
+    }
     // 解析 url 并存储
     auto urlFunc = std::bind(&HttpRequest::setUrl, this, std::placeholders::_1);
     start = splitLine(start, end, " ", urlFunc);
+    if (start == nullptr) {
+        return ParseResult::ERROR;
+    }
     // 解析 version 并存储
     auto versionFunc = std::bind(&HttpRequest::setVersion, this, std::placeholders::_1);
     splitLine(start, end, nullptr, versionFunc);
+    if (m_method.empty() || m_url.empty() || m_version.compare(0, 5, "HTTP/") != 0) {
+        return ParseResult::ERROR;
+    }
 
     // 更新状态
     read_buffer->readPosIncrease(line_size + 2);  // 跳过 /r/n
     setState(PrecessState::HEADERS);  // 修改处理状态
-    return true;
+    return ParseResult::COMPLETE;
 }
 
 
@@ -136,7 +185,7 @@ bool HttpRequest::addHeader(const std::string key, const std::string value, std:
 }
 
 /** 
- * @description: 根据指定 Header key 值获取其相应 value 值
+ * @description: 根据指定 Header key 值获取其相应 value 值，key 不区分大小写（例如 Connection 与 connection）
  * @description: 可以根据某些 value 判断是否允许其进行访问
  * @param {string} key: Header key
  * @param {map<std::string, std::string>*} map: 需要操作的集合
@@ -144,56 +193,91 @@ bool HttpRequest::addHeader(const std::string key, const std::string value, std:
  */
 std::string HttpRequest::getHeader(const std::string key, std::map<std::string, std::string>* map) {
     auto item = map->find(key);
-    if (item == map->end()) {
-        return std::string();
+    if (item != map->end()) {
+        return item->second;
+    }
+    for (item = map->begin(); item != map->end(); ++item) {
+        if (strcasecmp(item->first.data(), key.data()) == 0) {
+            return item->second;
+        }
     }
-    return item->second;
+    return std::string();
 }
 
 
 /** 
  * @description: 解析请求头
- * @description: 该函数可能会被调用多次，因为请求头可能会拥有多条信息，需要多次提取
+ * @description: 该函数可能会被调用多次，因为请求头可能会拥有多条信息，需要多次提取；数据不完整时返回 AGAIN，已经解析的请求头保留
  * @param {Buffer*} read_buffer: 存放请求数据的缓冲区
- * @return {bool} 解析成功返回 true，解析失败返回 false
+ * @return {ParseResult} 解析成功返回 COMPLETE；请求头不完整返回 AGAIN；格式错误或者超出长度限制返回 ERROR
  */
-bool HttpRequest::parseHeader(Buffer* read_buffer) {
-    char* end = read_buffer->findCRLF();  // 请求头结束地址
+ParseResult HttpRequest::parseHeader(Buffer* read_buffer) {
+    char* end = findLineEnd(read_buffer);  // 请求头结束地址
     if (end == nullptr) {
-        return false;
+        // 请求头不完整，单行或者总长度超出限制时不再等待
+        int size = read_buffer->readableSize();
+        return size > m_max_line_size || m_header_size + size > m_max_header_size ? ParseResult::ERROR : ParseResult::AGAIN;
     }
     char* start = read_buffer->readPos();  // 请求头起始地址
     int line_size = end - start;  // 请求头总长度
-    
-    // 搜索字符串  请求头格式 xxxx: xxxx 中间被 冒号和空格 分开
-    char* middle = static_cast<char*>(memmem(start, line_size, ": ", 2));
-    if (middle != nullptr) {
-        int key_len = middle - start;
-        int value_len = end - (middle + 2);
-        if (key_len > 0 && value_len > 0) {
-            std::string key(start, key_len);
-            std::string value(middle + 2, value_len);
-            addHeader(key, value, &m_reqquest_headers);
-        }
-        // 更新位置
-        read_buffer->readPosIncrease(line_size + 2);  // 跳过 /r/n
+    m_header_size += line_size + 2;
+    if (line_size > m_max_line_size || m_header_size > m_max_header_size) {
+        return ParseResult::ERROR;
     }
-    else {  // 此时解析到了空行，如果是 GET 请求，则直接结束，如果是 POST 请求则后续是请求体
-        if (strcasecmp(m_method.data(), "get") == 0 || strcasecmp(m_method.data(), "head") == 0) {  // GET 请求或 HEAD 请求
-            read_buffer->readPosIncrease(2);  // 跳过空行
-            setState(PrecessState::DONE);  // 修改解析状态
-        }
-        else if (strcasecmp(m_method.data(), "post") == 0) {  // POST 请求
-            read_buffer->readPosIncrease(2);  // 跳过空行
-            setState(PrecessState::BODY);  // 修改解析状态
+
+    if (line_size == 0) {  // 解析到了空行，请求头结束
+        read_buffer->readPosIncrease(2);  // 跳过空行
+        return endHeaders();
+    }
+
+    // 搜索字符串  请求头格式 xxxx: xxxx 中间被冒号分开，冒号前后的空白可以省略
+    char* middle = static_cast<char*>(memchr(start, ':', line_size));
+    if (middle == nullptr || middle == start) {
+        return ParseResult::ERROR;
+    }
+    char* value = middle + 1;
+    while (value < end && (*value == ' ' || *value == '\t')) {
+        ++value;
+    }
+    char* value_end = end;
+    while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+        --value_end;
+    }
+    addHeader(std::string(start, middle - start), std::string(value, value_end - value), &m_reqquest_headers);
+
+    // 更新位置
+    read_buffer->readPosIncrease(line_size + 2);  // 跳过 /r/n
+    return ParseResult::COMPLETE;
+}
+
+/** 
+ * @description: 请求头解析完毕，根据 Content-Length 确定请求体长度，没有请求体时请求解析完毕
+ * @description: 不支持分块传输（Transfer-Encoding），无法确定请求的边界，按照格式错误处理
+ * @return {ParseResult} 成功返回 COMPLETE；请求体长度不合法或者超出限制返回 ERROR
+ */
+ParseResult HttpRequest::endHeaders() {
+    if (!getHeader("Transfer-Encoding", &m_reqquest_headers).empty()) {
+        return ParseResult::ERROR;
+    }
+    std::string length = getHeader("Content-Length", &m_reqquest_headers);
+    if (!length.empty()) {
+        char* stop = nullptr;
+        long value = strtol(length.data(), &stop, 10);
+        if (stop == length.data() || *stop != '\0' || value < 0 || value > m_max_body_size) {
+            return ParseResult::ERROR;
         }
+        m_content_length = static_cast<int>(value);
     }
-    return true;
+    setState(m_content_length > 0 ? PrecessState::BODY : PrecessState::DONE);  // 修改解析状态
+    return ParseResult::COMPLETE;
 }
 
 bool HttpRequest::splitBody(char* start, int line_size) {
      // 搜索字符串  请求头格式 xxx=yyy&xxx=yyy 中间被 & 分开
     char* split = static_cast<char*>(memmem(start, line_size, "=", 1));
+    if (split == nullptr) {
+        return false;
+    }
     int sub_len = line_size - (split + 1 - start);  // 获取 value 的长度
 
     // 添加键值对
@@ -204,42 +288,32 @@ bool HttpRequest::splitBody(char* start, int line_size) {
 }
 
 /** 
- * @description: 解析请求体
+ * @description: 解析请求体，等待 Content-Length 字节全部到达后一次性解析，之前到达的部分不会被扫描
+ * @description: 只有 POST 请求按照表单（xxx=yyy&xxx=yyy）解析，其他请求的请求体直接跳过，保证下一个请求从正确的位置开始解析
  * @param {Buffer*} read_buffer: 存放请求数据的缓冲区
- * @return {bool} 解析成功返回 true，解析失败返回 false
+ * @return {ParseResult} 解析成功返回 COMPLETE；请求体不完整返回 AGAIN
  */
-bool HttpRequest::parseBody(Buffer* read_buffer)  {
-    auto item = m_reqquest_headers.find("Content-Length");  // 取出存放请求体长度的容器
-    int remain_len = std::stoi(item->second);  // 获取剩余长度
-    int line_size = remain_len;  // 默认这次取出的长度是剩余长度（为最后一个键值对做准备）
-    
-    char* end = read_buffer->findCRLF(1);  // 请求头结束地址
-    char* start = read_buffer->readPos();  // 请求头起始地址
-
-    if (end == nullptr && remain_len <= 0) {  // 没有找到 & 并且 Content-Length 也全部取出
-        return false;
+ParseResult HttpRequest::parseBody(Buffer* read_buffer)  {
+    if (read_buffer->readableSize() < m_content_length) {
+        return ParseResult::AGAIN;
     }
-    else if (end != nullptr) {  // 当找到 &，更新本次取出的长度
-        line_size = end - start;  // 请求头总长度
+
+    char* start = read_buffer->readPos();  // 请求体起始地址
+    char* end = start + m_content_length;  // 请求体结束地址
+    if (strcasecmp(m_method.data(), "post") == 0) {
+        while (start < end) {
+            // 拆分并添加字符串，最后一个键值对之后没有 &
+            char* split = static_cast<char*>(memchr(start, '&', end - start));
+            int line_size = (split == nullptr ? end : split) - start;
+            splitBody(start, line_size);
+            start += line_size + 1;  // 跳过 & 符号
+        }
     }
-    
-    // 拆分并添加字符串
-    splitBody(start, line_size);
-    
+
     // 更新状态
-    remain_len -= line_size;  // 本次已经取出的内容
-    read_buffer->readPosIncrease(line_size);
-    if (end != nullptr) {  // & 符号
-        remain_len -= 1;  
-        read_buffer->readPosIncrease(1); 
-    }
-    item->second = std::to_string(remain_len);  // 更新 Content-Length
-    
-    if (remain_len == 0) {  // 更新解析状态
-        setState(PrecessState::DONE);  
-    }
-    
-    return true;
+    read_buffer->readPosIncrease(m_content_length);
+    setState(PrecessState::DONE);
+    return ParseResult::COMPLETE;
 }
 
 /** 
@@ -331,6 +405,8 @@ bool HttpRequest::processRequest(HttpResponse* response) {
 
     m_url = decodeMsg(m_url);  // 将含 UTF-8 编码的字符串解码成含有特殊字符的字符串
     const char* file = NULL;  // 处理客户端请求的静态资源(目录或者文件)
+    bool head_only = strcasecmp(m_method.data(), "head") == 0;  // HEAD 请求只回复响应头，Content-length 仍然是完整响应体的长度
+    response->setHeadOnly(head_only);
 
     // 确定文件此时的路径
     if (strcmp(m_url.data(), "/") == 0) {  // 相对路径
@@ -348,7 +424,11 @@ bool HttpRequest::processRequest(HttpResponse* response) {
         response->setFileName("skydash-free-bootstrap-admin-template-main/template/pages/samples/error-404.html");  // 待发送文件的文件名
         response->setStatusCode(StatusCode::NOTFOUND);  // 响应状态
         response->addHeader("Content-type", getFileType(".html"));  // 响应头
-        response->setFunc(sendFile);  // 发送 404 文件
+        ret = stat(response->getFileName().data(), &st);  // 长连接需要 404 页面的长度
+        response->addHeader("Content-length", std::to_string(ret == -1 ? 0 : st.st_size));  // 响应头
+        if (ret != -1 && !head_only) {
+            response->setBodyFd(openFile(response->getFileName()));  // 发送 404 文件
+        }
     }
     // 可以添加 else if 以控制某些文件不允许访问，组织 303 等
     else {  // 文件/目录存在
@@ -358,12 +438,14 @@ bool HttpRequest::processRequest(HttpResponse* response) {
         // 判断文件类型
         if (S_ISDIR(st.st_mode)) {  // 目录
             response->addHeader("Content-type", getFileType(".html"));  // 响应头
-            response->setFunc(sendDir);
+            response->setBuildFunc(buildDir);  // 目录页面由 TcpConnection 决定在哪个线程中生成
         }
         else {  // 文件
             response->addHeader("Content-type", getFileType(file));  // 响应头
             response->addHeader("Content-length", std::to_string(st.st_size));  // 响应头
-            response->setFunc(sendFile);  
+            if (!head_only) {
+                response->setBodyFd(openFile(file));
+            }
         }
     }
     return true;
@@ -371,19 +453,21 @@ bool HttpRequest::processRequest(HttpResponse* response) {
 
 
 /** 
- * @description: 发送目录
- * @param {string} dir_name: 待发送目录的目录名 
- * @param {Buffer*} send_buffer: 存储发送数据的缓冲区
- * @param {int} cfd: 用于通信的文件描述符
- * @return {bool} 成功返回 true，失败返回 false
+ * @description: 生成目录页面，需要遍历目录并获取每个文件的属性，比较耗时
+ * @description: 只读取文件系统并返回字符串，不接触连接和套接字，因此可以交给计算线程池执行
+ * @param {string} dir_name: 目录名 
+ * @return {string} 目录页面
  */
-bool HttpRequest::sendDir(std::string dir_name, Buffer* send_buffer, int cfd) {
+std::string HttpRequest::buildDir(std::string dir_name) {
+    std::string page;
     char buf[4096] = { 0 };
     sprintf(buf, "<html><head><title>%s</title></head><body><table>", dir_name.data());
+    page.append(buf);
 
     struct dirent** name_list;  // name_list 指向的是一个指针数组 struct dirent* tmp[]
     int num = scandir(dir_name.data(), &name_list, NULL, alphasort);  // alphasort 指定文件的排序方式
     for (int i = 0; i < num; ++i) {
+        buf[0] = '\0';
         struct stat st;
         char sub_path[1024] = { 0 };
         char* name = name_list[i]->d_name;  // 提取文件名 
@@ -396,55 +480,26 @@ bool HttpRequest::sendDir(std::string dir_name, Buffer* send_buffer, int cfd) {
         else {  // 如果目标是文件
             sprintf(buf + strlen(buf), "<tr><td><a href=\"%s\">%s</a></td><td>%ld</td></tr>", name, name, st.st_size);
         }
-        send_buffer->appendData(buf);  // 向缓冲区存储数据
-        send_buffer->sendData(cfd);  // 发送数据
-
-        // 重置
-        memset(buf, 0, sizeof(buf));
+        page.append(buf);
         free(name_list[i]);
     }
-    sprintf(buf, "</table></body></html>");
-    send_buffer->appendData(buf);
-    send_buffer->sendData(cfd);
+    page.append("</table></body></html>");
 
-    free(name_list);
-    return true;
+    if (num >= 0) {  // scandir 失败时 name_list 没有被申请
+        free(name_list);
+    }
+    return page;
 }
 
 /** 
- * @description: 发送文件
+ * @description: 打开响应文件，文件内容由 TcpConnection 在写事件中按预算分批读取并发送，避免一次性读入整个文件
  * @param {string} file_name: 待发送文件的文件名 
- * @param {Buffer*} send_buffer: 存储发送数据的缓冲区
- * @param {int} cfd: 用于通信的文件描述符
- * @return {bool} 成功返回 true，失败返回 false
+ * @return {int} 成功返回文件描述符，失败返回 -1
  */
-bool HttpRequest::sendFile(std::string file_name, Buffer* send_buffer, int cfd) {
-    // 1. 打开文件
-    int fd = open(file_name.data(), O_RDONLY);
-    if (fd <= 0) {
+int HttpRequest::openFile(std::string file_name) {
+    int fd = open(file_name.data(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
         perror("open file");
-        close(fd);
-        return false;
-    }
-
-    // 2. 发送文件
-    while (true) {
-        char buf[1024];
-        int len = read(fd, buf, sizeof buf);
-        if (len > 0) {  // 发送
-            send_buffer->appendData(buf, len);
-            send_buffer->sendData(cfd);
-        }
-        else if (len == 0) {  // 发送完毕
-            break;
-        }
-        else {  // 出错
-            close(fd);
-            perror("read");
-            return false;
-        }
     }
-
-    close(fd);
-    return true;
+    return fd;
 }
\ No newline at end of file
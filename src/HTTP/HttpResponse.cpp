@@ -9,12 +9,33 @@
  */
 
 #include "HttpResponse.h"
+#include <unistd.h>
 
 HttpResponse::HttpResponse() {
+	m_body_fd = -1;
+	reset();
+}
+
+HttpResponse::~HttpResponse() {
+	if (m_body_fd != -1) {
+		close(m_body_fd);
+	}
+}
+
+/** 
+ * @description: 重置 HttpResponse 对象，长连接在同一个对象上处理多个请求，响应头等状态不能带到下一个响应中
+ */
+void HttpResponse::reset() {
 	m_status_code = StatusCode::UNKNOWN;
 	m_headers.clear();
 	m_file_name = std::string();
-	sendDataFunc = nullptr;
+	if (m_body_fd != -1) {
+		close(m_body_fd);
+	}
+	m_body_fd = -1;
+	m_build_func = nullptr;
+	m_keep_alive = false;
+	m_head_only = false;
 }
 
 /** 
@@ -31,11 +52,12 @@ void HttpResponse::addHeader(const std::string key, const std::string value) {
 }
 
 /** 
- * @description: 组织响应头并发送，并调用发送数据的函数
+ * @description: 组织响应头并写入发送缓冲区，不在这里发送，流水线中的多个响应由 TcpConnection 合并后一起发送
+ * @description: 响应体不在这里写入，通过 setBuildFunc 设置的响应体由 TcpConnection 生成后写入发送缓冲区，通过 setBodyFd 设置的文件由 TcpConnection 分批发送
+ * @description: 长连接依靠 Content-length 划分响应，调用之前需要设置好响应体长度
  * @param {Buffer*} send_buffer: 存储待发送数据的缓冲区
- * @param {int} socket: 和客户端通信的文件描述符
  */
-void HttpResponse::prepareHeadMsg(Buffer* send_buffer, int socket) {
+void HttpResponse::prepareHeadMsg(Buffer* send_buffer) {
 	char tmp[1024] = { 0 };
 
 	// 组织响应行
@@ -48,13 +70,8 @@ void HttpResponse::prepareHeadMsg(Buffer* send_buffer, int socket) {
 		sprintf(tmp, "%s: %s\r\n", it->first.data(), it->second.data());
 		send_buffer->appendData(tmp);
 	}
+	send_buffer->appendData(m_keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n");
 
 	// 组织空行
 	send_buffer->appendData("\r\n");
-
-	// 发送响应头
-	send_buffer->sendData(socket);
-
-	// 发送数据
-	sendDataFunc(m_file_name, send_buffer, socket);
 }
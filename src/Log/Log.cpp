@@ -9,6 +9,7 @@
  */
 
 #include "Log.h"
+#include "CpuAffinity.h"
 #include <chrono>
 #include <sys/stat.h>
 #include <assert.h>
@@ -213,10 +214,12 @@ void Log::working() {
 
 /** 
  * @description: 日志文件启动函数
+ * @param {int} cpu: 日志线程绑定的 CPU，通常选择不运行反应堆模型的 CPU，小于 0 表示不绑定
  */
-void Log::run() {
+void Log::run(int cpu) {
     assert(!m_start);  // 保证日志类没有被启动
     m_start = true;  // 启动日志类
     perror("start");
     m_thread = new std::thread(&Log::working, this);  // 构造线程
+    CpuAffinity::bindThread(m_thread, cpu);
 }
\ No newline at end of file
@@ -19,6 +19,19 @@ Channel::Channel(int fd, FDEvent events, handleFunc readFunc, handleFunc writeFu
 	destroyCallback = destroyFunc;
 }
 
+/** 
+ * @description: 修改 fd 的读事件（检测 or 不检测），不检测读事件时对端关闭或者出错仍然会通过读回调通知
+ * @param {bool} flag: true 允许读事件，否则不允许
+ */
+void Channel::readEventEnable(bool flag) {
+	if (flag) {
+		m_events |= static_cast<int>(FDEvent::READEVENT);
+	}
+	else {
+		m_events = m_events & ~static_cast<int>(FDEvent::READEVENT);
+	}
+}
+
 /** 
  * @description: 修改 fd 的写事件（检测 or 不检测）
  * @param {bool} flag: true 允许写事件，否则不允许
@@ -39,3 +52,46 @@ void Channel::writeEventEnable(bool flag) {
 bool Channel::isWriteEventEnable() {
 	return m_events & static_cast<int>(FDEvent::WRITEEVENT);
 }
+
+
+/** 
+ * @description: 修改 fd 的触发方式，边沿触发时就绪事件只通知一次，读写回调需要一直处理到 EAGAIN
+ * @param {bool} flag: true 边沿触发，否则水平触发
+ */
+void Channel::edgeTriggerEnable(bool flag) {
+	if (flag) {
+		m_events |= static_cast<int>(FDEvent::EDGETRIGGER);
+	}
+	else {
+		m_events = m_events & ~static_cast<int>(FDEvent::EDGETRIGGER);
+	}
+}
+
+/** 
+ * @description: 判断文件描述符是否为边沿触发
+ * @return {bool} 边沿触发返回 true，否则返回 false
+ */
+bool Channel::isEdgeTrigger() {
+	return m_events & static_cast<int>(FDEvent::EDGETRIGGER);
+}
+
+/** 
+ * @description: 修改 fd 是否单次触发，单次触发的 channel 注册在领导者/跟随者模式共享的 epoll 实例中，不属于任何一个反应堆模型
+ * @param {bool} flag: true 单次触发，否则由反应堆模型检测
+ */
+void Channel::oneShotEnable(bool flag) {
+	if (flag) {
+		m_events |= static_cast<int>(FDEvent::ONESHOT);
+	}
+	else {
+		m_events = m_events & ~static_cast<int>(FDEvent::ONESHOT);
+	}
+}
+
+/** 
+ * @description: 判断文件描述符是否为单次触发
+ * @return {bool} 单次触发返回 true，否则返回 false
+ */
+bool Channel::isOneShot() {
+	return m_events & static_cast<int>(FDEvent::ONESHOT);
+}
@@ -11,39 +11,119 @@
 #include "EventLoop.h"
 #include <assert.h>
 #include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdio.h>
 #include "SelectDispatcher.h"
 #include "EpollDispatcher.h"
 #include "PollDispatcher.h"
+#include "IoUringDispatcher.h"
+#include "DispatcherSelector.h"
+#include "LeaderFollower.h"
 
 
 /** 
- * @description: 主线程调用，用于唤醒子线程函数，通过本地通信向子线程发送一个消息，解除子线程阻塞
+ * @description: 根据 Backend 创建分发器，Backend 为具体子类时直接创建该子类，忽略运行时指定的类型与预期连接数
  */
-void EventLoop::taskWakeup() {
-	const char* msg = "wake up";
-	write(m_socket_pair[0], msg, strlen(msg));
+template <typename Backend>
+struct DispatcherFactory {
+	static Backend* create(EventLoop* event_loop, DispatcherType& type, int) {
+		type = DispatcherSelector::typeOf<Backend>();
+		return new Backend(event_loop);
+	}
+};
+
+/** 
+ * @description: Backend 为抽象类 Dispatcher 时（运行时多态），根据 type 创建对应的子类，io_uring 不可用时退回 epoll
+ * @param {int} expected_fds: AUTO 自检时模拟的连接数
+ */
+template <>
+struct DispatcherFactory<Dispatcher> {
+	static Dispatcher* create(EventLoop* event_loop, DispatcherType& type, int expected_fds) {
+		if (type == DispatcherType::AUTO) {
+			type = DispatcherSelector::calibrate(expected_fds);
+		}
+		if (type == DispatcherType::IOURING && !IoUringDispatcher::isSupported()) {
+			printf("io_uring is not supported, fall back to epoll\n");  // 此时日志线程尚未启动
+			type = DispatcherType::EPOLL;
+		}
+		switch (type) {
+		case DispatcherType::POLL:
+			return new PollDispatcher(event_loop);
+		case DispatcherType::SELECT:
+			return new SelectDispatcher(event_loop);
+		case DispatcherType::IOURING:
+			return new IoUringDispatcher(event_loop);
+		default:
+			type = DispatcherType::EPOLL;
+			return new EpollDispatcher(event_loop);
+		}
+	}
+};
+
+/** 
+ * @description: 主线程调用，用于唤醒子线程函数，通过 eventfd 向子线程发送一个通知，解除子线程阻塞
+ * @description: 子线程读取通知之前的多次唤醒会被合并，只有第一次唤醒需要写 eventfd
+ */
+template <typename Backend>
+void BasicEventLoop<Backend>::taskWakeup() {
+	if (m_wakeup_pending.exchange(true)) {  // 已经有尚未被读取的通知
+		return;
+	}
+	uint64_t one = 1;
+	write(m_wakeup_fd, &one, sizeof(one));
 }
 
-EventLoop::EventLoop() : EventLoop(std::string()) { }  // 委托构造函数
+template <typename Backend>
+BasicEventLoop<Backend>::BasicEventLoop() : BasicEventLoop(std::string()) { }  // 委托构造函数
 
-EventLoop::EventLoop(const std::string thread_name) {
+template <typename Backend>
+BasicEventLoop<Backend>::BasicEventLoop(const std::string thread_name, DispatcherType type, int expected_fds) : m_taskQ(8192) {
 	m_quit = true;  // 默认没有启动
 	m_threadID = std::this_thread::get_id();  // 获取控制该反应堆模型的线程 ID
 	m_thread_name = thread_name == std::string() ? "MainThread" : thread_name;
-	m_dispatcher = new EpollDispatcher(this);  // 设置底层实现模型
-	m_channel_map.clear();
-
-	// 创建一对用于本地通信的套接字，用于激活被阻塞的线程
-	int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, m_socket_pair);
-	if (ret == -1) {
-		perror("socketpair");
+	m_dispatcher_type = type;
+	m_leader_follower = nullptr;
+	m_busy_poll_us = 0;
+	m_spin_us = 0;
+	m_work_us = 0;
+	m_spin_hits = 0;
+	m_blocks = 0;
+	m_write_budget = 64 * 1024;
+	m_turn_budget_us = 5000;
+	m_turn_start = 0;
+	m_busy_us = 0;
+	m_idle_timeout = 15000;
+	m_max_requests = 1000;
+	m_dispatcher = DispatcherFactory<Backend>::create(this, m_dispatcher_type, expected_fds);  // 设置底层实现模型
+	m_channels.assign(1024, nullptr);  // 预留常用的文件描述符范围，超出时再扩容
+	m_connection_count = 0;
+	m_incoming_cpu_hits = 0;
+	m_incoming_cpu_misses = 0;
+	m_pending_tasks = 0;
+	m_iterations = 0;
+	m_iteration_start = 0;
+	m_iteration_end = 0;
+	m_stage = LoopStage::IDLE;
+	m_current_fd = -1;
+	for (int i = 0; i < m_stall_buckets; ++i) {
+		m_stall_histogram[i] = 0;
+	}
+	m_watched = false;
+	m_probe_fd = -1;
+
+	// 创建用于线程间通知的 eventfd，用于激活被阻塞的线程
+	m_wakeup_pending = false;
+	m_wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m_wakeup_fd == -1) {
+		perror("eventfd");
 		exit(0);
 	}
-	auto read_callback = std::bind(&EventLoop::readLocalMessage, this);  // 将读取本地信息的函数当作 raeacallback
-	Channel* channel = new Channel(m_socket_pair[1], FDEvent::READEVENT, read_callback, nullptr, nullptr, this);
-	// 将用于本地通信的 channel 添加到任务队列
+	// 将读取本地信息的静态函数当作 readcallback，this 作为回调参数
+	Channel* channel = new Channel(m_wakeup_fd, FDEvent::READEVENT, readLocalMessage, nullptr, nullptr, this);
+	// 将用于线程间通知的 channel 添加到任务队列
 	addTask(channel, ElemType::ADD);
 }
 
@@ -52,7 +132,8 @@ EventLoop::EventLoop(const std::string thread_name) {
  * @description: 启动反应堆模型，持续检测就绪文件描述符
  * @return {int} 成功返回 0；失败返回 -1
  */
-int EventLoop::run() {
+template <typename Backend>
+int BasicEventLoop<Backend>::run() {
 	// 比较线程 ID 是否正常, 非所有者
 	if (m_threadID != std::this_thread::get_id()) {
 		return -1;
@@ -63,35 +144,190 @@ int EventLoop::run() {
 
 	// 循环处理事件，检测并处理就绪文件描述符
 	while (!m_quit) {
-		m_dispatcher->dispatch(2);  // 阻塞函数，主线程调用唤醒函数后，子线程从此处解除阻塞
-		processTaskQ();  // 此处是主线程调用唤醒函数后，子线程处理主线程给子线程添加的任务的动作，这个任务就是本地通信
+		if (m_busy_poll_us.load(std::memory_order_relaxed) > 0) {
+			busyPoll();
+		}
+		else {
+			runOnce(m_timer_wheel.nextTimeout(m_max_timeout));  // 根据最近的定时器计算阻塞时长
+		}
 	}
 	return 0;
 }
 
 /** 
- * @description: 处理文件描述符对应事件
- * @param {int} fd: 文件描述符（对应其在 channel_map 中的下标）
- * @param {int} event: 处理事件
- * @return {int} 成功返回 0；失败返回 -1
+ * @description: 忙轮询，以超时时间 0 反复检测事件，检测到事件时处理并返回，下一轮重新开始计算预算
+ * @description: 预算用完仍然没有事件时退回阻塞等待，空闲时不会一直占用 CPU；低负载下请求到达时线程多半还在自旋，省去一次唤醒和上下文切换
+ * @return {int} 本轮就绪的文件描述符个数
  */
-int EventLoop::eventActive(int fd, int event) {
-	if (fd < 0) {
-		return -1;
+template <typename Backend>
+int BasicEventLoop<Backend>::busyPoll() {
+	int64_t now = TimerWheel::nowUs();
+	int64_t deadline = now + m_busy_poll_us.load(std::memory_order_relaxed);
+	while (!m_quit && now < deadline) {
+		int count = runOnce(0);
+		int64_t end = TimerWheel::nowUs();
+		if (count > 0) {
+			m_work_us.fetch_add(end - now, std::memory_order_relaxed);
+			m_spin_hits.fetch_add(1, std::memory_order_relaxed);
+			return count;
+		}
+		m_spin_us.fetch_add(end - now, std::memory_order_relaxed);
+		now = end;
 	}
+	m_blocks.fetch_add(1, std::memory_order_relaxed);
+	return runOnce(m_timer_wheel.nextTimeout(m_max_timeout));
+}
 
-	// 取出 channel
-	Channel* channel = m_channel_map[fd];  // 通过 fd 找到 channel
-	assert(channel->getSocket() == fd);
+/** 
+ * @description: 获取忙轮询统计，可以由任意线程调用，各项数据分别读取，只是近似值
+ * @return {BusyPollStats} 忙轮询统计
+ */
+template <typename Backend>
+BusyPollStats BasicEventLoop<Backend>::getBusyPollStats() {
+	BusyPollStats stats;
+	stats.spin_us = m_spin_us.load(std::memory_order_relaxed);
+	stats.work_us = m_work_us.load(std::memory_order_relaxed);
+	stats.spin_hits = m_spin_hits.load(std::memory_order_relaxed);
+	stats.blocks = m_blocks.load(std::memory_order_relaxed);
+	return stats;
+}
 
-	// 处理文件描述符对应事件
-	if (event & (int)FDEvent::READEVENT && channel->readCallback != NULL) {
-		channel->readCallback(const_cast<void*>(channel->getArg()));  // 处理文件描述符的读事件
+/** 
+ * @description: 执行一轮事件循环，只能由所属线程调用
+ * @param {int} timeout: dispatch 阻塞时长（毫秒）
+ * @return {int} 本轮就绪的文件描述符个数
+ */
+template <typename Backend>
+int BasicEventLoop<Backend>::runOnce(int timeout) {
+	m_turn_start = 0;
+	int count = m_dispatcher->dispatch(timeout);  // 阻塞函数，主线程调用唤醒函数后，子线程从此处解除阻塞
+	int64_t now = TimerWheel::nowUs();
+	if (m_turn_start == 0) {  // 本轮没有就绪事件，从 dispatch 返回开始计算
+		iterationBegin(now);
 	}
-	if (event & (int)FDEvent::WRITEEVENT && channel->writeCallback != NULL) {
-		channel->writeCallback(const_cast<void*>(channel->getArg()));  // 处理文件描述符的写事件
+	m_stage.store(LoopStage::TIMER, std::memory_order_relaxed);
+	m_timer_wheel.advance(now / 1000);  // 执行到期的定时器
+	m_stage.store(LoopStage::TASK, std::memory_order_relaxed);
+	processTaskQ();  // 此处是主线程调用唤醒函数后，子线程处理主线程给子线程添加的任务的动作，这个任务就是本地通信
+
+	// 统计忙碌时间：有就绪事件时从第一个事件开始，否则从 dispatch 返回开始，阻塞等待的时间不计入
+	int64_t start = m_turn_start > 0 ? m_turn_start : now;
+	int64_t end = TimerWheel::nowUs();
+	m_busy_us.fetch_add(end - start, std::memory_order_relaxed);
+	iterationEnd(start, end);
+	return count;
+}
+
+/** 
+ * @description: 发布本轮开始处理的时间，看门狗据此判断本轮是否阻塞过久
+ * @param {int64_t} now: 开始时间（微秒）
+ */
+template <typename Backend>
+void BasicEventLoop<Backend>::iterationBegin(int64_t now) {
+	m_iteration_start.store(now, std::memory_order_relaxed);
+}
+
+/** 
+ * @description: 发布本轮结束的时间与心跳，并将本轮耗时记入分布
+ * @param {int64_t} start: 本轮开始时间（微秒）
+ * @param {int64_t} end: 本轮结束时间（微秒）
+ */
+template <typename Backend>
+void BasicEventLoop<Backend>::iterationEnd(int64_t start, int64_t end) {
+	m_stage.store(LoopStage::IDLE, std::memory_order_relaxed);
+	m_iteration_start.store(0, std::memory_order_relaxed);
+	m_iteration_end.store(end, std::memory_order_relaxed);
+	m_iterations.fetch_add(1, std::memory_order_relaxed);
+
+	int64_t ms = (end - start) / 1000;
+	int index = 0;
+	while (ms > 0 && index < m_stall_buckets - 1) {
+		ms >>= 1;
+		++index;
 	}
-	return 0;
+	m_stall_histogram[index].fetch_add(1, std::memory_order_relaxed);
+}
+
+/** 
+ * @description: 连接发布当前请求的描述，看门狗发现阻塞时，如果阻塞在该文件描述符的回调中，会一并输出描述
+ * @param {int} fd: 文件描述符
+ * @param {string&} label: 描述（请求行）
+ */
+template <typename Backend>
+void BasicEventLoop<Backend>::publishProbe(int fd, const std::string& label) {
+	std::lock_guard<std::mutex> locker(m_probe_mutex);
+	m_probe_fd = fd;
+	m_probe_label = label;
+}
+
+/** 
+ * @description: 获取心跳快照，可以由任意线程调用，各项数据分别读取，只是近似值
+ * @return {LoopHeartbeat} 心跳快照
+ */
+template <typename Backend>
+LoopHeartbeat BasicEventLoop<Backend>::getHeartbeat() {
+	LoopHeartbeat heartbeat;
+	heartbeat.iterations = m_iterations.load(std::memory_order_relaxed);
+	heartbeat.iteration_start = m_iteration_start.load(std::memory_order_relaxed);
+	heartbeat.iteration_end = m_iteration_end.load(std::memory_order_relaxed);
+	heartbeat.stage = m_stage.load(std::memory_order_relaxed);
+	heartbeat.fd = m_current_fd.load(std::memory_order_relaxed);
+	if (heartbeat.fd != -1) {
+		std::lock_guard<std::mutex> locker(m_probe_mutex);
+		if (m_probe_fd == heartbeat.fd) {
+			heartbeat.label = m_probe_label;
+		}
+	}
+	return heartbeat;
+}
+
+/** 
+ * @description: 获取每轮处理耗时的分布，可以由任意线程调用
+ * @return {vector<uint64_t>} 各个桶的计数，桶的名称由 stallBucketName 给出
+ */
+template <typename Backend>
+std::vector<uint64_t> BasicEventLoop<Backend>::getStallHistogram() {
+	std::vector<uint64_t> histogram;
+	for (int i = 0; i < m_stall_buckets; ++i) {
+		histogram.push_back(m_stall_histogram[i].load(std::memory_order_relaxed));
+	}
+	return histogram;
+}
+
+/** 
+ * @description: 耗时分布各个桶的名称
+ * @param {int} index: 桶的下标
+ * @return {string&} 名称，例如 "<1ms"、"4-8ms"、">=1024ms"
+ */
+template <typename Backend>
+const std::string& BasicEventLoop<Backend>::stallBucketName(int index) {
+	static const std::string names[m_stall_buckets] = {
+		"<1ms", "1-2ms", "2-4ms", "4-8ms", "8-16ms", "16-32ms", "32-64ms",
+		"64-128ms", "128-256ms", "256-512ms", "512-1024ms", ">=1024ms"
+	};
+	return names[index];
+}
+
+/** 
+ * @description: 退出反应堆模型，可以由任意线程调用，所属线程执行完本轮任务后从 run 中返回
+ */
+template <typename Backend>
+void BasicEventLoop<Backend>::quit() {
+	runInLoop([this]() {
+		m_quit = true;
+	});
+}
+
+/** 
+ * @description: 释放分发器以及用于线程间通知的 channel，其余 channel 由各自的 TcpConnection 释放，需要在所属线程中析构
+ */
+template <typename Backend>
+BasicEventLoop<Backend>::~BasicEventLoop() {
+	Channel* channel = findChannel(m_wakeup_fd);
+	if (channel != nullptr) {
+		freeChannel(channel);
+	}
+	delete m_dispatcher;
 }
 
 /** 
@@ -100,17 +336,24 @@ int EventLoop::eventActive(int fd, int event) {
  * @param {ElemType} type: 处理文件描述符的动作
  * @return {int} 成功返回 0；失败返回 -1
  */
-int EventLoop::addTask(Channel* channel, ElemType type) {
-	// step 1：添加任务
-	m_mutex.lock();  // 加锁，保护共享资源
-
-	// 创建新节点
-	ChannelElement* task = new ChannelElement;
-	task->channel = channel;
-	task->type = type;
-	m_taskQ.push(task);
+template <typename Backend>
+int BasicEventLoop<Backend>::addTask(Channel* channel, ElemType type) {
+	// 单次触发的 channel 注册在共享的 epoll 实例中，epoll_ctl 线程安全，由调用线程（正在处理该 channel 的线程）直接操作，不经过任务队列
+	if (channel->isOneShot() && m_leader_follower != nullptr) {
+		if (type == ElemType::ADD) {
+			return m_leader_follower->add(channel);
+		}
+		if (type == ElemType::DELETE) {
+			return m_leader_follower->remove(channel);
+		}
+		return m_leader_follower->modify(channel);
+	}
 
-	m_mutex.unlock();  // 解锁
+	// step 1：添加任务（无锁，节点按值存放在任务队列中）
+	ChannelElement task;
+	task.channel = channel;
+	task.type = type;
+	pushTask(std::move(task));
 
 	// step2：处理任务
 	/*
@@ -134,46 +377,194 @@ int EventLoop::addTask(Channel* channel, ElemType type) {
 }
 
 /** 
- * @description: 处理任务队列中的任务（添加、修改、删除）文件描述符
- * @return {int} 成功返回 0；失败返回 -1
+ * @description: 将任务放入任务队列，队列已满时等待所属线程处理，所属线程自己添加时直接处理已有任务腾出位置
+ * @param {ChannelElement&&} task: 任务节点
  */
-int EventLoop::processTaskQ() {
-	while (!m_taskQ.empty()) {
-		m_mutex.lock();  // 加锁，保护共享资源
-		ChannelElement* node = m_taskQ.front();  // 取出节点
-		m_taskQ.pop();
-		m_mutex.unlock();  // 解锁
+template <typename Backend>
+void BasicEventLoop<Backend>::pushTask(ChannelElement&& task) {
+	m_pending_tasks.fetch_add(1, std::memory_order_relaxed);
+	while (!m_taskQ.push(std::move(task))) {
+		if (isInLoopThread()) {
+			processTaskQ();
+		}
+		else {
+			taskWakeup();
+			std::this_thread::yield();
+		}
+	}
+}
 
-		Channel* channel = node->channel;
+/** 
+ * @description: 处理任务队列中的任务（添加、修改、删除文件描述符，执行投递的任务）
+ * @return {int} 成功返回 0；失败返回 -1
+ */
+template <typename Backend>
+int BasicEventLoop<Backend>::processTaskQ() {
+	ChannelElement node;
+	while (m_taskQ.pop(node)) {  // 只有所属线程会取出节点，无需加锁
+		m_pending_tasks.fetch_sub(1, std::memory_order_relaxed);
+		Channel* channel = node.channel;
 		// 处理动作
-		if (node->type == ElemType::ADD) {  // 添加
+		if (node.type == ElemType::ADD) {  // 添加
 			add(channel);
 		}
-		else if (node->type == ElemType::DELETE) {  // 删除
+		else if (node.type == ElemType::DELETE) {  // 删除
 			remove(channel);
 		}
-		else if (node->type == ElemType::MODIFY) {  // 修改
+		else if (node.type == ElemType::MODIFY) {  // 修改
 			modify(channel);
 		}
-
-		delete node;
+		else if (node.type == ElemType::FUNCTOR) {  // 执行投递的任务
+			node.functor();
+			node.functor = nullptr;
+		}
+		else if (node.type == ElemType::CALLBACK) {  // 调用投递的函数
+			node.func(this, node.arg, node.fd);
+		}
+		else if (node.type == ElemType::TIMER) {  // 其他线程添加的定时器
+			m_timer_wheel.add(node.timer, node.delay, node.interval, std::move(node.functor));
+			node.functor = nullptr;
+		}
 	}
 	return 0;
 }
 
+/** 
+ * @description: 在反应堆模型所属线程中执行任务，由所属线程调用时直接执行，否则投递到任务队列
+ * @param {Functor} functor: 待执行的任务
+ */
+template <typename Backend>
+void BasicEventLoop<Backend>::runInLoop(Functor functor) {
+	if (isInLoopThread()) {
+		functor();
+	}
+	else {
+		queueInLoop(std::move(functor));
+	}
+}
+
+/** 
+ * @description: 将任务投递到任务队列，由所属线程在本轮事件处理完毕后执行
+ * @param {Functor} functor: 待执行的任务
+ */
+template <typename Backend>
+void BasicEventLoop<Backend>::queueInLoop(Functor functor) {
+	ChannelElement task;
+	task.type = ElemType::FUNCTOR;
+	task.channel = nullptr;
+	task.functor = std::move(functor);
+	pushTask(std::move(task));
+
+	if (!isInLoopThread()) {  // 所属线程可能阻塞在 dispatch 中
+		taskWakeup();
+	}
+}
+
+/** 
+ * @description: 将任务投递到任务队列，任务为普通函数指针，参数按值存放在任务节点中，投递时不会申请内存
+ * @param {TaskFunc} func: 在所属线程中调用的函数，第一个参数为当前反应堆模型
+ * @param {void*} arg: func 的参数
+ * @param {int} fd: func 的参数
+ */
+template <typename Backend>
+void BasicEventLoop<Backend>::queueInLoop(TaskFunc func, void* arg, int fd) {
+	ChannelElement task;
+	task.type = ElemType::CALLBACK;
+	task.channel = nullptr;
+	task.func = func;
+	task.arg = arg;
+	task.fd = fd;
+	pushTask(std::move(task));
+
+	if (!isInLoopThread()) {
+		taskWakeup();
+	}
+}
+
+/** 
+ * @description: 将其他线程添加的定时器投递给所属线程，回调直接移动到任务节点中，不需要再包装成一个捕获回调的任务
+ * @param {TimerId} id: 定时器编号
+ * @param {int64_t} delay: 延迟时间（毫秒）
+ * @param {int64_t} interval: 重复间隔（毫秒），0 表示只执行一次
+ * @param {function<void()>&&} functor: 到期回调
+ */
+template <typename Backend>
+void BasicEventLoop<Backend>::queueTimer(TimerId id, int64_t delay, int64_t interval, std::function<void()>&& functor) {
+	ChannelElement task;
+	task.type = ElemType::TIMER;
+	task.channel = nullptr;
+	task.timer = id;
+	task.delay = delay;
+	task.interval = interval;
+	task.functor = std::move(functor);
+	pushTask(std::move(task));
+	taskWakeup();
+}
+
+/** 
+ * @description: 添加定时器，delay 毫秒后在所属线程中执行一次
+ * @param {int64_t} delay: 延迟时间（毫秒）
+ * @param {Functor} functor: 到期回调
+ * @return {TimerId} 定时器编号，用于取消
+ */
+template <typename Backend>
+TimerId BasicEventLoop<Backend>::runAfter(int64_t delay, Functor functor) {
+	TimerId id = m_timer_wheel.nextId();
+	if (isInLoopThread()) {
+		m_timer_wheel.add(id, delay, 0, std::move(functor));
+	}
+	else {
+		queueTimer(id, delay, 0, std::move(functor));
+	}
+	return id;
+}
+
+/** 
+ * @description: 添加定时器，每隔 interval 毫秒在所属线程中执行一次
+ * @param {int64_t} interval: 重复间隔（毫秒）
+ * @param {Functor} functor: 到期回调
+ * @return {TimerId} 定时器编号，用于取消
+ */
+template <typename Backend>
+TimerId BasicEventLoop<Backend>::runEvery(int64_t interval, Functor functor) {
+	TimerId id = m_timer_wheel.nextId();
+	if (isInLoopThread()) {
+		m_timer_wheel.add(id, interval, interval, std::move(functor));
+	}
+	else {
+		queueTimer(id, interval, interval, std::move(functor));
+	}
+	return id;
+}
+
+/** 
+ * @description: 取消定时器
+ * @param {TimerId} id: 定时器编号
+ */
+template <typename Backend>
+void BasicEventLoop<Backend>::cancel(TimerId id) {
+	runInLoop([this, id]() {
+		m_timer_wheel.cancel(id);
+	});
+}
+
 /** 
  * @description: 添加文件描述符
  * @param {Channel*} channel: 封装文件描述符的管道
  * @return {int} 成功返回 0；失败返回 -1
  */
-int EventLoop::add(Channel* channel) {
+template <typename Backend>
+int BasicEventLoop<Backend>::add(Channel* channel) {
 	int fd = channel->getSocket();  // 获取封装的文件描述符
 
 	// 如果之前没有存储过该文件描述符，存储该文件描述符
-	if (m_channel_map.find(fd) == m_channel_map.end()) {
-		m_channel_map.insert(std::make_pair(fd, channel));  // 往 channel_map 添加该文件描述符
-		m_dispatcher->setChannel(channel);  // 设置 dispatcher 的 channel，由于一个反应堆模型只有一个 dispatcher 因此需要告诉 dispatcher 需要操作哪个 channel
-		int ret = m_dispatcher->add();  // 将文件描述符添加到对应的检测集合中
+	if (findChannel(fd) == nullptr) {
+		if (fd >= static_cast<int>(m_channels.size())) {  // 成倍扩容，避免频繁搬移
+			size_t size = m_channels.size() * 2;
+			m_channels.resize(size > static_cast<size_t>(fd) ? size : fd + 1, nullptr);
+		}
+		m_channels[fd] = channel;  // 往 channel 表添加该文件描述符
+		int ret = m_dispatcher->add(channel);  // 将文件描述符添加到对应的检测集合中
 		return ret;
 	}
 	return -1;
@@ -184,16 +575,38 @@ int EventLoop::add(Channel* channel) {
  * @param {Channel*} channel: 封装文件描述符的管道
  * @return {int} 成功返回 0；失败返回 -1
  */
-int EventLoop::remove(Channel* channel) {
+template <typename Backend>
+int BasicEventLoop<Backend>::remove(Channel* channel) {
 	int fd = channel->getSocket();  // 获取文件描述符
 
 	// 如果文件描述符不在记录的文件描述符映射中，移除失败
-	if (m_channel_map.find(fd) == m_channel_map.end()) {
+	if (findChannel(fd) == nullptr) {
+		return -1;
+	}
+
+	int ret = m_dispatcher->remove(channel);  // 将文件描述符从对应检测集合中移除
+	// 通过 channel 释放对应的 TcpConnection 资源
+	if (channel->destroyCallback != nullptr) {
+		channel->destroyCallback(const_cast<void*>(channel->getArg()));
+	}
+	return ret;
+}
+
+/** 
+ * @description: 将 channel 从检测集合与 channel 表中摘除，但不释放 channel 和文件描述符，用于把连接迁移到其他反应堆模型，只能由所属线程调用
+ * @description: 摘除后本轮尚未处理的就绪事件在 eventActive 中找不到 channel，会被直接丢弃
+ * @param {Channel*} channel: 封装文件描述符的管道
+ * @return {int} 成功返回 0；失败返回 -1
+ */
+template <typename Backend>
+int BasicEventLoop<Backend>::detach(Channel* channel) {
+	int fd = channel->getSocket();
+	if (findChannel(fd) != channel) {
 		return -1;
 	}
 
-	m_dispatcher->setChannel(channel);  // 设置 dispatcher 的 channel
-	int ret = m_dispatcher->remove();  // 将文件描述符从对应检测集合中移除
+	int ret = m_dispatcher->remove(channel);
+	m_channels[fd] = nullptr;
 	return ret;
 }
 
@@ -202,16 +615,16 @@ int EventLoop::remove(Channel* channel) {
  * @param {Channel*} channel: channel: 封装文件描述符的管道
  * @return {int} 成功返回 0；失败返回 -1
  */
-int EventLoop::modify(Channel* channel) {
+template <typename Backend>
+int BasicEventLoop<Backend>::modify(Channel* channel) {
 	int fd = channel->getSocket();  // 获取文件描述符
 
-	// 检测是否存在 fd 和 channel 的键值对
-	if (m_channel_map.find(fd) == m_channel_map.end()) {
+	// 检测是否存在 fd 和 channel 的对应关系
+	if (findChannel(fd) == nullptr) {
 		return -1;
 	}
 
-	m_dispatcher->setChannel(channel);  // 设置 dispatcher 的 channel
-	int ret = m_dispatcher->modify();  // 修改检测集合中文件描述符检测事件
+	int ret = m_dispatcher->modify(channel);  // 修改检测集合中文件描述符检测事件
 	return ret;
 }
 
@@ -220,13 +633,19 @@ int EventLoop::modify(Channel* channel) {
  * @param {Channel*} channel: channel: 封装文件描述符的管道
  * @return {int} 成功返回 0；失败返回 -1
  */
-int EventLoop::freeChannel(Channel* channel) {
-	auto it = m_channel_map.find(channel->getSocket());
-	if (it == m_channel_map.end()) {
+template <typename Backend>
+int BasicEventLoop<Backend>::freeChannel(Channel* channel) {
+	int fd = channel->getSocket();
+	if (channel->isOneShot()) {  // 单次触发的 channel 不在 channel 表中，可以由任意线程释放
+		close(fd);
+		delete channel;
+		return 0;
+	}
+	if (findChannel(fd) == nullptr) {
 		return -1;
 	}
 
-	m_channel_map.erase(it);  // 删除 channel 和 fd 的对应关系
+	m_channels[fd] = nullptr;  // 删除 channel 和 fd 的对应关系
 	close(channel->getSocket());  // 关闭文件描述符
 	delete channel;  // 释放资源
 
@@ -234,13 +653,19 @@ int EventLoop::freeChannel(Channel* channel) {
 }
 
 /** 
- * @description: 读取本地通信文件描述符发送的信息
+ * @description: 读取 eventfd 的通知，一次读取即可清空计数
+ * @description: 读取后清除等待标志，此后添加的任务会重新写 eventfd，之前添加的任务在本轮 processTaskQ 中处理
  * @param {void*} arg: 反应堆模型实例
  * @return {int} 成功返回 0；失败返回 -1
  */
-int EventLoop::readLocalMessage(void* arg) {
-	EventLoop* evLoop = static_cast<EventLoop*>(arg);
-	char buf[256];
-	int ret = read(evLoop->m_socket_pair[1], buf, sizeof(buf));
-	return ret;
+template <typename Backend>
+int BasicEventLoop<Backend>::readLocalMessage(void* arg) {
+	BasicEventLoop* evLoop = static_cast<BasicEventLoop*>(arg);
+	uint64_t count = 0;
+	int ret = read(evLoop->m_wakeup_fd, &count, sizeof(count));
+	evLoop->m_wakeup_pending.exchange(false);  // 与生产者的 exchange 同步，保证之前添加的任务对本线程可见
+	return ret == -1 ? -1 : 0;
 }
+
+// 显式实例化，成员函数定义只在本文件中编译一次
+template class BasicEventLoop<ReactorBackend>;
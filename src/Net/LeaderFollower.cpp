@@ -0,0 +1,145 @@
+/** 
+ * @author: yuyuyuj1e 807152541@qq.com
+ * @github: https://github.com/yuyuyuj1e
+ * @csdn: https://blog.csdn.net/yuyuyuj1e
+ * @date: 2023-03-24 10:18:36
+ * @last_edit_time: 2023-03-24 10:18:36
+ * @file_path: /CC/src/Net/LeaderFollower.cpp
+ * @description: 领导者/跟随者线程模型源文件
+ */
+
+#include "LeaderFollower.h"
+#include "CpuAffinity.h"
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/** 
+ * @param {int} thread_num: 线程数量
+ */
+LeaderFollower::LeaderFollower(int thread_num) : m_thread_num(thread_num) {
+	m_quit = false;
+	m_epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (m_epfd == -1) {
+		perror("epoll_create1");
+		exit(0);
+	}
+}
+
+LeaderFollower::~LeaderFollower() {
+	m_quit = true;
+	for (auto thread : m_threads) {
+		thread->join();
+		delete thread;
+	}
+	close(m_epfd);
+}
+
+/** 
+ * @description: 启动线程，所有线程执行相同的 follow，没有固定的领导者
+ */
+void LeaderFollower::run() {
+	for (int i = 0; i < m_thread_num; ++i) {
+		m_threads.push_back(new std::thread(&LeaderFollower::follow, this, i));
+	}
+}
+
+/** 
+ * @description: 以 EPOLLONESHOT 方式操作共享的 epoll 实例，channel 的地址保存在 data.ptr 中
+ * @param {Channel*} channel: 封装文件描述符的 channel
+ * @param {int} op: EPOLL_CTL_ADD / EPOLL_CTL_MOD / EPOLL_CTL_DEL
+ * @return {int} 成功返回 0；失败返回 -1
+ */
+int LeaderFollower::epollCtl(Channel* channel, int op) {
+	struct epoll_event ev;
+	ev.data.ptr = channel;
+
+	int events = EPOLLONESHOT;  // 触发一次后失效，处理完毕前不会再交给其他线程
+	if (channel->getEvent() & static_cast<int>(FDEvent::READEVENT)) {
+		events |= EPOLLIN;
+	}
+	if (channel->getEvent() & static_cast<int>(FDEvent::WRITEEVENT)) {
+		events |= EPOLLOUT;
+	}
+	if (channel->getEvent() & static_cast<int>(FDEvent::EDGETRIGGER)) {
+		events |= EPOLLET;
+	}
+	ev.events = events;
+
+	return epoll_ctl(m_epfd, op, channel->getSocket(), &ev);
+}
+
+/** 
+ * @description: 将文件描述符添加到共享的 epoll 实例中
+ * @param {Channel*} channel: 封装文件描述符的 channel
+ * @return {int} 成功返回 0；失败返回 -1
+ */
+int LeaderFollower::add(Channel* channel) {
+	int ret = epollCtl(channel, EPOLL_CTL_ADD);
+	if (ret == -1) {
+		perror("epoll_ctl add");
+	}
+	return ret;
+}
+
+/** 
+ * @description: 将文件描述符从共享的 epoll 实例中删除，并通过 channel 释放对应的资源
+ * @param {Channel*} channel: 封装文件描述符的 channel
+ * @return {int} 成功返回 0；失败返回 -1
+ */
+int LeaderFollower::remove(Channel* channel) {
+	int ret = epollCtl(channel, EPOLL_CTL_DEL);
+	if (ret == -1) {
+		perror("epoll_ctl del");
+	}
+	if (channel->destroyCallback != nullptr) {
+		channel->destroyCallback(const_cast<void*>(channel->getArg()));
+	}
+	return ret;
+}
+
+/** 
+ * @description: 修改检测的事件，同时重新注册已经触发过的文件描述符
+ * @param {Channel*} channel: 封装文件描述符的 channel
+ * @return {int} 成功返回 0；失败返回 -1
+ */
+int LeaderFollower::modify(Channel* channel) {
+	int ret = epollCtl(channel, EPOLL_CTL_MOD);
+	if (ret == -1) {
+		perror("epoll_ctl mod");
+	}
+	return ret;
+}
+
+/** 
+ * @description: 线程函数，每次只取出一个就绪事件，处理期间其他线程接替等待
+ * @description: 每个事件只调用一个回调：检测写事件时优先发送，否则读（异常与挂断也交给读回调，读到 0 或 -1 后断开连接）
+ * @description: 回调负责重新注册或者删除 channel，删除后 channel 已被释放，回调返回后不能再访问
+ * @param {int} index: 线程编号
+ */
+void LeaderFollower::follow(int index) {
+	if (index < static_cast<int>(m_cpus.size())) {
+		CpuAffinity::bindCurrentThread(m_cpus[index]);
+	}
+
+	struct epoll_event ev;
+	while (!m_quit) {
+		int num = epoll_wait(m_epfd, &ev, 1, m_max_timeout);
+		if (num <= 0) {  // 超时或者被信号中断
+			continue;
+		}
+
+		Channel* channel = static_cast<Channel*>(ev.data.ptr);
+		void* arg = const_cast<void*>(channel->getArg());
+		if ((ev.events & EPOLLOUT) && channel->isWriteEventEnable() && channel->writeCallback != nullptr) {
+			channel->writeCallback(arg);
+		}
+		else if ((ev.events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && channel->readCallback != nullptr) {
+			channel->readCallback(arg);
+		}
+		else {  // 没有可以处理的回调，重新注册，避免 channel 永久失效
+			modify(channel);
+		}
+	}
+}
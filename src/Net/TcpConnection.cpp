@@ -11,55 +11,459 @@
 #include "TcpConnection.h"
 #include "HttpRequest.h"
 #include "DebugLog.h"
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 
 
+/** 
+ * @description: 接收数据，没有正在处理的响应时解析并处理请求；上一个响应还在生成或者发送时，数据留在接收缓冲区中，响应完毕后再处理
+ * @description: 响应期间关闭读事件检测，之后到达的数据留在套接字中由 TCP 流量控制限制，接收缓冲区不会因为客户端持续发送而无限增长
+ * @description: 对端关闭或者出错时断开连接；空闲计时器到期时会关闭套接字（shutdown），同样从这里读到 0 后断开
+ * @param {void*} arg: TcpConnection 实例
+ * @return {int} 返回 0
+ */
 int TcpConnection::processRead(void* arg) {
 	TcpConnection* conn = static_cast<TcpConnection*>(arg);
 	// 接受数据
 	int socket = conn->m_channel->getSocket();
-	int count = conn->m_read_buffer->readData(socket);
+	int count = 0;
+	int ret = 0;
+	if (conn->m_channel->isEdgeTrigger()) {
+		// 边沿触发只通知一次，需要一直读到 EAGAIN，否则剩余数据在下一次有新数据到达前都不会再被通知
+		// 读取的数据量受每轮预算限制，超出后随后的 MODIFY 会重新注册，套接字仍然可读时在下一轮再次通知
+		int budget = conn->m_event_loop->getWriteBudget();
+		while (count < budget && (ret = conn->m_read_buffer->readData(socket)) > 0) {
+			count += ret;
+		}
+	}
+	else {
+		ret = conn->m_read_buffer->readData(socket);
+		count = ret > 0 ? ret : 0;
+	}
 
-	Debug("receive http request data: %s", conn->m_read_buffer->readPos());
-	conn->m_log->addTask(conn->m_name + '\n' + conn->m_read_buffer->readPos(), 1);
-	// Log::addTaskStatic(conn->m_name + '\n' + conn->m_read_buffer->readPos(), 1, conn->m_log);
-	
 	if (count > 0) {
-		// 接收到了 http 请求，解析 http 请求
-		bool flag = conn->m_request->parseRequest(conn->m_read_buffer, conn->m_response, conn->m_write_buffer, socket);
-		
-		if (!flag) {
-			// 解析失败
-			std::string err_msg = "Http/1.1 400 Bad Request\r\n\r\n";
-			conn->m_write_buffer->appendData(err_msg);
-			conn->m_log->addTask(conn->m_name + '\n' + "400 Bad Request", 1);
-			// Log::addTaskStatic(conn->m_name + '\n' + "400 Bad Request", 1, conn->m_log);
+		Debug("receive http request data: %s", conn->m_read_buffer->readPos());
+		conn->m_log->addTask(conn->m_name + '\n' + conn->m_read_buffer->readPos(), 1);
+		// Log::addTaskStatic(conn->m_name + '\n' + conn->m_read_buffer->readPos(), 1, conn->m_log);
+		conn->m_guard->generation.fetch_add(1, std::memory_order_relaxed);  // 连接不再空闲
+		conn->cancelIdleTimer();
+
+		if (conn->isResponding()) {
+			// 上一个响应还在生成或者发送中，数据留在缓冲区；单次触发时需要重新注册，响应体生成完毕后会由计算结果重新注册
+			if (conn->m_channel->isOneShot() && !conn->m_body_pending) {
+				conn->m_event_loop->addTask(conn->m_channel, ElemType::MODIFY);
+			}
+			return 0;
 		}
+		conn->handleRequest();
+		return 0;
 	}
-	// 断开连接
-	conn->m_event_loop->addTask(conn->m_channel, ElemType::DELETE);
+	if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+		// 没有读到数据但连接正常：同一个套接字积压的多个就绪通知中，前面的通知已经把数据读完；单次触发时需要重新注册
+		if (conn->m_channel->isOneShot() && !conn->m_body_pending) {
+			conn->m_event_loop->addTask(conn->m_channel, ElemType::MODIFY);
+		}
+		return 0;
+	}
+	// 断开连接（先记录日志，DELETE 任务会直接释放 conn）
 	conn->m_log->addTask(conn->m_name + '\n' + "closed", 1);
 	// Log::addTaskStatic(conn->m_name + '\n' + "closed", 0, conn->m_log);
+	conn->m_event_loop->addTask(conn->m_channel, ElemType::DELETE);
 	return 0;
 }
 
+/** 
+ * @description: 依次处理接收缓冲区中已经完整到达的请求（流水线），响应按请求顺序写入发送缓冲区，最后合并成一次发送
+ * @description: 遇到需要分批发送的响应体文件、需要在计算线程池中生成的响应体或者关闭连接的响应时停止，剩余请求在该响应完成后继续处理
+ * @description: 每批最多处理 m_max_pipeline 个请求，发送缓冲区中的数据超过 m_max_pipeline_size 时同样停止，避免一个连接长时间占用线程
+ * @description: 请求不完整时解析状态保存在 m_request 中，没有可以发送的响应时启动空闲计时器并等待后续数据
+ * @description: 空闲计时器在每次收到数据时重新计时，因此不完整的请求另外由请求计时器限制到齐的时间，避免缓慢发送请求头的客户端一直占用连接
+ */
+void TcpConnection::handleRequest() {
+	int count = 0;
+	do {
+		if (!respondOne()) {
+			break;
+		}
+		++count;
+	} while (count < m_max_pipeline && hasNextRequest());
+
+	if (m_body_pending) {  // 响应体在计算线程池中生成，生成完毕后继续，期间不再读取数据
+		m_channel->readEventEnable(false);
+		if (!m_channel->isOneShot()) {  // 单次触发时由计算结果重新注册
+			m_event_loop->addTask(m_channel, ElemType::MODIFY);
+		}
+		return;
+	}
+	if (count == 0 && m_write_buffer->readableSize() == 0) {  // 第一个请求还不完整，并且没有已经生成的响应（计算线程池交还结果后继续处理时会有）
+		armIdleTimer();
+		armRequestTimer();
+		m_event_loop->addTask(m_channel, ElemType::MODIFY);
+		return;
+	}
+	sendResponse();
+}
+
+/** 
+ * @description: 判断是否可以继续处理接收缓冲区中的下一个请求（流水线）
+ * @return {bool} 可以继续处理返回 true
+ */
+bool TcpConnection::hasNextRequest() {
+	return m_keep_alive && m_body_fd == -1 && m_write_buffer->readableSize() < m_max_pipeline_size
+		&& m_read_buffer->readableSize() > 0;
+}
+
+/** 
+ * @description: 解析并处理接收缓冲区中的一个请求，响应写入发送缓冲区；较小的响应体文件直接读入发送缓冲区，与后续响应合并发送
+ * @description: 达到最多请求数量或者关闭了长连接时，响应头中的 Connection 为 close，发送完毕后断开
+ * @return {bool} 响应已经写入发送缓冲区返回 true；请求不完整或者响应体正在计算线程池中生成返回 false
+ */
+bool TcpConnection::respondOne() {
+	publishProbe(true);
+	int max_requests = m_event_loop->getMaxRequests();
+	m_response->reset();  // 上一个响应的响应头等状态不能带到这个响应中
+	m_response->setKeepAlive(m_event_loop->getIdleTimeout() > 0 && (max_requests == 0 || m_requests + 1 < max_requests));
+
+	// 接收到了 http 请求，解析 http 请求
+	ParseResult result = m_request->parseRequest(m_read_buffer, m_response, m_write_buffer);
+	if (result == ParseResult::AGAIN) {  // 请求不完整，收到更多数据后继续解析
+		return false;
+	}
+	++m_requests;
+	m_guard->requests.fetch_add(1, std::memory_order_relaxed);  // 请求已经完整到达
+	cancelRequestTimer();
+	if (result == ParseResult::ERROR) {
+		// 解析失败，回复后断开连接
+		std::string err_msg = "HTTP/1.1 400 Bad Request\r\nContent-length: 0\r\nConnection: close\r\n\r\n";
+		m_write_buffer->appendData(err_msg);
+		m_keep_alive = false;
+		m_log->addTask(m_name + '\n' + "400 Bad Request", 1);
+		// Log::addTaskStatic(m_name + '\n' + "400 Bad Request", 1, m_log);
+		return true;
+	}
+
+	m_keep_alive = m_response->isKeepAlive();
+	if (m_response->isBodyPending()) {
+		// 响应体需要单独生成（如目录页面），生成完毕后再组织响应头
+		return buildBody();
+	}
+
+	m_body_fd = m_response->takeBodyFd();
+	struct stat st;
+	if (m_body_fd != -1 && fstat(m_body_fd, &st) == 0 && st.st_size <= m_chunk_size) {
+		while (fillBody()) {}  // 读取完毕后 fillBody 会关闭文件
+	}
+	return true;
+}
+
+/** 
+ * @description: 发送缓冲区中的数据，缓冲区发送完后从响应体文件中读取下一块继续发送，全部发送完毕后由 finishResponse 断开或者保持连接
+ * @description: 每轮最多发送 getWriteBudget 字节；本轮处理就绪事件的时间已经超出预算时只发送一块，大文件下载不会拖慢同一线程上的小请求
+ * @description: 用完预算时水平触发的写事件会在下一轮继续通知；边沿触发和单次触发不会再通知，需要重新注册
+ * @param {void*} arg: TcpConnection 实例
+ * @return {int} 返回 0
+ */
 int TcpConnection::processWrite(void* arg) {
 	TcpConnection* conn = static_cast<TcpConnection*>(arg);
-	// 发送数据
-	int count = conn->m_write_buffer->sendData(conn->m_channel->getSocket());
-	if (count > 0) {
-		// 判断数据是否全部发送
-		if (conn->m_write_buffer->readableSize() == 0) {
-			// 1. 不再检测写事件 —— 修改 channel 中保存的事件
-			conn->m_channel->writeEventEnable(false);
-			// 2. 修改 dispathcer 检测的集合 —— 添加任务节点
-			conn->m_event_loop->addTask(conn->m_channel, ElemType::MODIFY);
-			// 3. 删除节点 —— 断开链接
-			conn->m_event_loop->addTask(conn->m_channel, ElemType::DELETE);
+	int socket = conn->m_channel->getSocket();
+	int budget = conn->m_event_loop->getWriteBudget();
+	conn->publishProbe(false);
+	if (!conn->m_channel->isOneShot() && conn->m_event_loop->isTurnOverBudget()) {  // 单次触发的连接不属于该反应堆模型的本轮事件
+		budget = m_chunk_size;
+	}
+
+	int sent = 0;
+	int count = 0;
+	while (sent < budget) {
+		if (conn->m_write_buffer->readableSize() == 0 && !conn->fillBody()) {  // 响应数据已经全部发送
+			break;
+		}
+		count = conn->m_write_buffer->sendData(socket);
+		if (count <= 0) {
+			break;
 		}
+		sent += count;
+	}
+
+	if (count == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+		// 发送出错（对端已关闭），直接断开连接
+		conn->m_event_loop->addTask(conn->m_channel, ElemType::DELETE);
+	}
+	else if (conn->m_write_buffer->readableSize() == 0 && conn->m_body_fd == -1) {
+		// 数据已经全部发送
+		conn->finishResponse();
+	}
+	else if (conn->m_channel->isOneShot() || (count > 0 && conn->m_channel->isEdgeTrigger())) {
+		// 单次触发的写事件已经失效；边沿触发时用完预算但套接字仍然可写，不会再有新的通知，都需要重新注册
+		conn->m_event_loop->addTask(conn->m_channel, ElemType::MODIFY);
 	}
 	return 0;
 }
 
+/** 
+ * @description: 反应堆模型被看门狗检测时，发布当前请求的请求行，回调阻塞时看门狗据此定位到具体请求
+ * @description: 读事件从接收缓冲区中取出新请求的请求行并保存，写事件发布保存的请求行；单次触发的连接不在所属反应堆模型中处理，不发布
+ * @param {bool} new_request: 是否收到了新请求
+ */
+void TcpConnection::publishProbe(bool new_request) {
+	if (!m_event_loop->isWatched() || m_channel->isOneShot()) {
+		return;
+	}
+	if (new_request) {
+		char* end = m_read_buffer->findCRLF();
+		int size = end == nullptr ? m_read_buffer->readableSize() : static_cast<int>(end - m_read_buffer->readPos());
+		m_request_line.assign(m_read_buffer->readPos(), size < m_max_probe_size ? size : m_max_probe_size);
+	}
+	m_event_loop->publishProbe(m_channel->getSocket(), m_request_line);
+}
+
+/** 
+ * @description: 生成响应体，有计算线程池时交给计算线程池，生成完毕后将结果投递回当前反应堆模型写入发送缓冲区，再继续处理流水线中的请求；否则直接在当前线程生成
+ * @return {bool} 在当前线程生成完毕返回 true；交给计算线程池返回 false
+ */
+bool TcpConnection::buildBody() {
+	std::function<std::string(std::string)> build = m_response->getBuildFunc();
+	std::string name = m_response->getFileName();
+	m_response->setBuildFunc(nullptr);
+
+	if (m_compute_pool == nullptr) {
+		completeBody(build(name));
+		return true;
+	}
+
+	m_body_pending = true;
+	std::shared_ptr<std::string> body = std::make_shared<std::string>();
+	std::shared_ptr<bool> alive = m_alive;
+	TcpConnection* conn = this;
+	m_compute_pool->submit([build, name, body]() {
+		*body = build(name);  // 计算线程中只访问 body，不接触连接
+	}, m_event_loop, [conn, alive, body]() {
+		if (!*alive) {  // 生成期间连接已经断开并被释放
+			return;
+		}
+		conn->m_body_pending = false;
+		conn->completeBody(*body);
+		if (conn->hasNextRequest()) {
+			conn->handleRequest();
+		}
+		else {
+			conn->sendResponse();
+		}
+	});
+	return false;
+}
+
+/** 
+ * @description: 响应体生成完毕，此时才知道响应体长度，组织响应头后写入响应体（HEAD 请求只回复响应头）
+ * @param {string&} body: 响应体
+ */
+void TcpConnection::completeBody(const std::string& body) {
+	m_response->addHeader("Content-length", std::to_string(body.size()));
+	m_response->prepareHeadMsg(m_write_buffer);
+	if (!m_response->isHeadOnly()) {
+		m_write_buffer->appendData(body);
+	}
+}
+
+/** 
+ * @description: 从响应体文件中读取一块数据写入发送缓冲区，读取完毕或者出错时关闭文件
+ * @return {bool} 读取到数据返回 true；没有响应体文件或者已经读取完毕返回 false
+ */
+bool TcpConnection::fillBody() {
+	if (m_body_fd == -1) {
+		return false;
+	}
+	char buf[m_chunk_size];
+	int len = read(m_body_fd, buf, sizeof buf);
+	if (len > 0) {
+		m_write_buffer->appendData(buf, len);
+		return true;
+	}
+	if (len == -1) {
+		perror("read");
+	}
+	close(m_body_fd);
+	m_body_fd = -1;
+	return false;
+}
+
+/** 
+ * @description: 发送缓冲区中合并好的响应，先直接发送一次，通常一次 send 就能全部发出，不需要等待写事件
+ * @description: 非阻塞套接字的发送缓冲区满时数据会滞留在 m_write_buffer 中，交给写事件继续发送；响应体文件同样交给写事件，每轮按预算分批读取发送
+ * @description: 全部发出后直接结束本次响应；接收缓冲区中还有流水线请求时不在这里继续处理，而是打开写事件检测，由下一轮的写事件（套接字可写时立即通知）处理下一批
+ * @description: 这样每轮最多处理一批请求，不会在一次回调中递归处理完接收缓冲区中的所有请求
+ */
+void TcpConnection::sendResponse() {
+	int count = m_write_buffer->sendData(m_channel->getSocket());
+	if (count == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+		// 发送出错（对端已关闭），直接断开连接
+		m_event_loop->addTask(m_channel, ElemType::DELETE);
+		return;
+	}
+	if (m_write_buffer->readableSize() > 0 || m_body_fd != -1 || (m_keep_alive && m_read_buffer->readableSize() > 0)) {  // 剩余数据或者下一批请求留到下一轮处理
+		m_channel->writeEventEnable(true);
+		m_channel->readEventEnable(false);
+		m_event_loop->addTask(m_channel, ElemType::MODIFY);
+		return;
+	}
+	finishResponse();
+}
+
+/** 
+ * @description: 响应发送完毕：短连接直接断开；长连接关闭写事件检测、重新打开读事件检测并启动空闲计时，接收缓冲区中已经有下一个请求时直接处理
+ * @description: 单次触发时 MODIFY 会重新注册，之后连接可能立即被其他线程处理，因此 MODIFY 必须是最后一个访问连接的操作
+ */
+void TcpConnection::finishResponse() {
+	if (!m_keep_alive) {
+		// 删除节点 —— 断开链接（不需要先修改检测的事件，单次触发时修改会重新注册，删除前可能被其他线程处理）
+		m_log->addTask(m_name + '\n' + "closed", 1);
+		m_event_loop->addTask(m_channel, ElemType::DELETE);
+		return;
+	}
+
+	m_channel->writeEventEnable(false);
+	m_channel->readEventEnable(true);
+	if (m_read_buffer->readableSize() > 0) {  // 发送期间已经收到了下一个请求
+		handleRequest();
+		return;
+	}
+	armIdleTimer();
+	m_event_loop->addTask(m_channel, ElemType::MODIFY);
+}
+
+/** 
+ * @description: 判断是否有正在生成或者发送的响应，此时收到的请求需要等待
+ * @return {bool} 有返回 true
+ */
+bool TcpConnection::isResponding() {
+	return m_body_pending || m_body_fd != -1 || m_write_buffer->readableSize() > 0 || m_channel->isWriteEventEnable();
+}
+
+/** 
+ * @description: 启动空闲计时器，到期时如果期间没有收到数据，关闭套接字的读写（shutdown），由处理读事件的线程读到 0 后正常断开
+ * @description: 计时器回调只通过 m_guard 访问文件描述符，不接触连接本身，因此无论连接已经迁移到其他线程还是已经释放都是安全的
+ */
+void TcpConnection::armIdleTimer() {
+	int timeout = m_event_loop->getIdleTimeout();
+	if (timeout <= 0) {
+		return;
+	}
+	std::shared_ptr<IdleGuard> guard = m_guard;
+	uint64_t generation = guard->generation.load(std::memory_order_relaxed);
+	m_idle_loop = m_event_loop;
+	m_idle_timer = m_event_loop->runAfter(timeout, [guard, generation]() {
+		std::lock_guard<std::mutex> locker(guard->mutex);
+		if (guard->fd != -1 && guard->generation.load(std::memory_order_relaxed) == generation) {
+			shutdown(guard->fd, SHUT_RDWR);
+		}
+	});
+}
+
+/** 
+ * @description: 取消空闲计时器，cancel 是线程安全的，领导者/跟随者模式下由处理连接的线程投递给主反应堆模型执行，计时器不会在时间轮中堆积
+ * @description: 迁移时在源反应堆模型所属线程中取消，之后计时器总是在连接当前所属的反应堆模型中，不会投递给已经退役的子线程
+ */
+void TcpConnection::cancelIdleTimer() {
+	if (m_idle_timer != 0) {
+		m_idle_loop->cancel(m_idle_timer);
+	}
+	m_idle_timer = 0;
+}
+
+/** 
+ * @description: 启动请求计时器，已经启动时不重新计时；到期时如果请求仍然没有完整到达，与空闲计时器一样关闭套接字的读写
+ * @description: 超时时间与空闲超时相同，即一个请求从第一个字节到达开始，必须在空闲超时内完整到达
+ */
+void TcpConnection::armRequestTimer() {
+	int timeout = m_event_loop->getIdleTimeout();
+	if (timeout <= 0 || m_request_timer != 0) {
+		return;
+	}
+	std::shared_ptr<IdleGuard> guard = m_guard;
+	uint64_t requests = guard->requests.load(std::memory_order_relaxed);
+	m_request_loop = m_event_loop;
+	m_request_timer = m_event_loop->runAfter(timeout, [guard, requests]() {
+		std::lock_guard<std::mutex> locker(guard->mutex);
+		if (guard->fd != -1 && guard->requests.load(std::memory_order_relaxed) == requests) {
+			shutdown(guard->fd, SHUT_RDWR);
+		}
+	});
+}
+
+/** 
+ * @description: 取消请求计时器，与空闲计时器相同
+ */
+void TcpConnection::cancelRequestTimer() {
+	if (m_request_timer != 0) {
+		m_request_loop->cancel(m_request_timer);
+	}
+	m_request_timer = 0;
+}
+
+/** 
+ * @description: 判断连接是否空闲，空闲连接只剩下套接字、缓冲区以及解析状态，可以安全地交给其他线程
+ * @return {bool} 空闲返回 true
+ */
+bool TcpConnection::isIdle() {
+	return !m_body_pending && m_body_fd == -1 && m_write_buffer->readableSize() == 0
+		&& !m_channel->isWriteEventEnable() && !m_channel->isOneShot();
+}
+
+/** 
+ * @description: 将连接迁移到 target，只能由当前所属线程调用
+ * @description: 1. 从当前反应堆模型中摘除 channel，此后当前线程不会再处理该连接的事件
+ * @description: 2. 修改所属的反应堆模型并转移连接计数
+ * @description: 3. 由 target 所属线程注册 channel，任务队列的发布与取出保证之前的修改对 target 所属线程可见，之后当前线程不能再访问该连接
+ * @description: 迁移期间到达的数据留在套接字接收缓冲区中，注册后由 target 检测到（边沿触发注册时同样会检测当前状态）
+ * @param {EventLoop*} target: 目标反应堆模型
+ */
+void TcpConnection::migrate(EventLoop* target) {
+	m_log->addTask(m_name + '\n' + "migrated", 1);
+	m_event_loop->detach(m_channel);
+	m_event_loop->connectionDetached();
+	target->connectionAttached();
+	bool idle_timer = m_idle_timer != 0;
+	bool request_timer = m_request_timer != 0;
+	cancelIdleTimer();
+	cancelRequestTimer();
+	m_event_loop = target;
+	if (idle_timer) {  // 空闲计时器在 target 中重新开始
+		armIdleTimer();
+	}
+	if (request_timer) {  // 请求计时器同样在 target 中重新开始，源反应堆模型可能随后退役
+		armRequestTimer();
+	}
+	target->addTask(m_channel, ElemType::ADD);
+}
+
+/** 
+ * @description: 遍历 source 的 channel 表，将最多 max_count 个空闲连接迁移到 target，用于平衡各个子反应堆模型的负载
+ * @param {EventLoop*} source: 连接当前所属的反应堆模型，必须在其所属线程中调用
+ * @param {EventLoop*} target: 目标反应堆模型
+ * @param {int} max_count: 最多迁移的连接数量
+ * @return {int} 实际迁移的连接数量
+ */
+int TcpConnection::migrateIdle(EventLoop* source, EventLoop* target, int max_count) {
+	int moved = 0;
+	int size = source->getChannelCapacity();
+	for (int fd = 0; fd < size && moved < max_count; ++fd) {
+		Channel* channel = source->findChannel(fd);
+		if (channel == nullptr || channel->destroyCallback != destroy) {  // 只迁移连接，跳过监听与线程间通知的 channel
+			continue;
+		}
+		TcpConnection* conn = static_cast<TcpConnection*>(const_cast<void*>(channel->getArg()));
+		if (conn->isIdle()) {
+			conn->migrate(target);
+			++moved;
+		}
+	}
+	return moved;
+}
+
 int TcpConnection::destroy(void* arg) {
 	TcpConnection* conn = static_cast<TcpConnection*>(arg);
 	if (conn != nullptr) {
@@ -68,8 +472,29 @@ int TcpConnection::destroy(void* arg) {
 	return 0;
 }
 
-TcpConnection::TcpConnection(int fd, EventLoop* event_loop) {
+/** 
+ * @param {int} fd: 通信文件描述符
+ * @param {EventLoop*} event_loop: 负责该连接的反应堆实例
+ * @param {bool} edge_trigger: 是否使用边沿触发，边沿触发时通信文件描述符会被设置为非阻塞
+ * @param {ComputePool*} compute_pool: 生成响应体的计算线程池，nullptr 表示在当前线程中生成
+ * @param {bool} one_shot: 是否单次触发，领导者/跟随者模式下连接注册在共享的 epoll 实例中，event_loop 只负责计数以及接收计算结果
+ */
+TcpConnection::TcpConnection(int fd, EventLoop* event_loop, bool edge_trigger, ComputePool* compute_pool, bool one_shot) {
 	m_event_loop = event_loop;
+	m_compute_pool = compute_pool;
+	m_body_pending = false;
+	m_alive = std::make_shared<bool>(true);
+	m_body_fd = -1;
+	m_keep_alive = false;
+	m_requests = 0;
+	m_guard = std::make_shared<IdleGuard>();
+	m_guard->fd = fd;
+	m_guard->generation = 0;
+	m_guard->requests = 0;
+	m_idle_timer = 0;
+	m_idle_loop = nullptr;
+	m_request_timer = 0;
+	m_request_loop = nullptr;
 	m_read_buffer = new Buffer(10240);
 	m_write_buffer = new Buffer(10240);
 	// http
@@ -77,16 +502,32 @@ TcpConnection::TcpConnection(int fd, EventLoop* event_loop) {
 	m_response = new HttpResponse;
 	m_name = "Connection-" + std::to_string(fd);
 	m_channel = new Channel(fd, FDEvent::READEVENT, processRead, processWrite, destroy, this);
+	if (edge_trigger) {
+		int flags = fcntl(fd, F_GETFL);
+		fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+		m_channel->edgeTriggerEnable(true);
+	}
+	m_channel->oneShotEnable(one_shot);
 	event_loop->addTask(m_channel, ElemType::ADD);
 
 }
 
 TcpConnection::~TcpConnection() {
-	if (m_read_buffer && m_read_buffer->readableSize() == 0 && m_write_buffer && m_write_buffer->readableSize() == 0) {
-		delete m_read_buffer;
-		delete m_write_buffer;
-		delete m_request;
-		delete m_response;
-		m_event_loop->freeChannel(m_channel);
+	*m_alive = false;  // 尚未交还的计算结果会被丢弃
+	{
+		std::lock_guard<std::mutex> locker(m_guard->mutex);  // 关闭文件描述符之前使空闲计时器失效，避免操作被复用的文件描述符
+		m_guard->fd = -1;
+	}
+	cancelIdleTimer();
+	cancelRequestTimer();
+	if (m_body_fd != -1) {  // 响应体尚未发送完毕时断开
+		close(m_body_fd);
 	}
+	// 出错断开时缓冲区中可能还有未处理的数据，同样需要释放
+	delete m_read_buffer;
+	delete m_write_buffer;
+	delete m_request;
+	delete m_response;
+	m_event_loop->freeChannel(m_channel);
+	m_event_loop->connectionDetached();  // 与 TcpServer 分配连接时的计数对应
 }
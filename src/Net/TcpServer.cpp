@@ -11,54 +11,168 @@
 #include "TcpServer.h"
 #include <stdlib.h>
 #include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
 #include "TcpConnection.h"
+#include "CpuAffinity.h"
 #include <stdio.h>
 
 
 /** 
  * @description: 检测到连接请求后的操作函数，获取通信文件描述符后将该文件描述符发送给线程池，让子线程处理通信，主线程继续监听通信
- * @description: 由于建立连接需要调用类私有成员 m_lfd（类静态成员可以调用私有成员），且类静态函数无需实例化对象也存在（存在地址）
+ * @description: 监听套接字是非阻塞的，每次监听事件循环调用 accept4 直到 EAGAIN 或者达到 m_accept_batch，每个连接作为一个 CALLBACK 任务交付，投递时不申请内存，同一批次中对同一个子线程的唤醒会被合并
+ * @description: 文件描述符耗尽（EMFILE/ENFILE）时，释放预留的空闲文件描述符，accept 后立即关闭该连接再重新预留，避免水平触发的监听事件不断就绪导致空转
+ * @description: 没有预留的文件描述符（预留失败）时暂停检测监听套接字，m_accept_retry 毫秒后再恢复
+ * @description: SO_REUSEPORT 模式下由子线程自己 accept，通信文件描述符直接交给当前子线程处理
+ * @description: 领导者/跟随者模式下由当前线程直接创建单次触发的连接，accept 完毕后重新注册监听套接字
+ * @description: 设置了 SO_BUSY_POLL 时，通信套接字在没有数据时先由内核忙轮询网卡队列，需要 CAP_NET_ADMIN 权限或者不超过 net.core.busy_read，设置失败时忽略
+ * @description: 由于建立连接需要调用类私有成员（类静态成员可以调用私有成员），且类静态函数无需实例化对象也存在（存在地址）
  * @description: 所以将该函数设置为类的静态成员函数更方便
- * @param {void*} arg: 服务器自身
- * @return {int} : 之所以需要设置返回值，是因为 Channel 设置的函数指针 function<int(void*)> 需要匹配类型
+ * @param {void*} arg: 监听器
+ * @return {int} : 之所以需要设置返回值，是因为 Channel 设置的函数指针 int(*)(void*) 需要匹配类型
  */
 int TcpServer::acceptConnection(void* arg) {
-	TcpServer* server = static_cast<TcpServer*>(arg);
-	// 和客户端建立链接
-	int cfd = accept(server->m_lfd, NULL, NULL);
+	Listener* listener = static_cast<Listener*>(arg);
+	TcpServer* server = listener->server;
+	bool paused = false;  // 监听器是否已经暂停
+
+	for (int i = 0; i < server->m_accept_batch; ++i) {
+		// 和客户端建立链接，通信文件描述符直接设置为非阻塞
+		struct sockaddr_in addr;
+		socklen_t addr_len = sizeof(addr);
+		int cfd = accept4(listener->lfd, (struct sockaddr*)&addr, &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (cfd == -1) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {  // 全连接队列已经取空
+				break;
+			}
+			if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO) {  // 单个连接出错，继续处理下一个
+				continue;
+			}
+			if ((errno == EMFILE || errno == ENFILE) && listener->idle_fd != -1) {
+				// 文件描述符耗尽，腾出预留的文件描述符接受该连接并立即关闭，让客户端尽快得到响应
+				close(listener->idle_fd);
+				cfd = accept(listener->lfd, NULL, NULL);
+				if (cfd != -1) {
+					close(cfd);
+				}
+				listener->idle_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+				server->m_log->addTask("accept: too many open files, connection dropped", 1);
+				continue;
+			}
+			if (errno == EMFILE || errno == ENFILE) {
+				server->pauseListener(listener);
+				paused = true;
+				break;
+			}
+			perror("accept4");
+			break;
+		}
+		if (server->m_socket_busy_poll_us > 0) {
+			setsockopt(cfd, SOL_SOCKET, SO_BUSY_POLL, &server->m_socket_busy_poll_us, sizeof(int));
+		}
+
+		if (server->m_leader_follower != nullptr) {  // 连接注册到共享的 epoll 实例后，立即可以由其他空闲线程处理
+			server->m_main_event_loop->connectionAttached();
+			new TcpConnection(cfd, server->m_main_event_loop, server->m_edge_trigger, server->m_compute_pool, true);
+			continue;
+		}
 
-	// 从线程池中取出一个子线程的反应堆模型，处理 cfd
-	EventLoop* evLoop = server->m_thread_pool->takeWorkerEventLoop();
+		// 从线程池中取出一个子线程的反应堆模型，处理 cfd；SO_REUSEPORT 模式下就是监听器所在的反应堆模型
+		EventLoop* evLoop = listener->event_loop;
+		if (evLoop == nullptr) {
+			evLoop = server->m_thread_pool->takeWorkerEventLoop(&addr, cfd);
+		}
+		evLoop->connectionAttached();  // 在分配时计数，同一批次中的后续连接就能看到该连接
+		// 将 cfd 交给子线程，由子线程创建 TcpConnection（缓冲区等资源在子线程中申请，主线程不需要加锁）
+		if (evLoop->isInLoopThread()) {
+			createConnection(evLoop, server, cfd);
+		}
+		else {
+			evLoop->queueInLoop(createConnection, server, cfd);
+		}
+	}
 
-	// 将 cfd 放到 TcpConnection 中处理
-	new TcpConnection(cfd, evLoop);
+	if (listener->channel->isOneShot() && !paused) {
+		server->m_main_event_loop->addTask(listener->channel, ElemType::MODIFY);
+	}
 	return 0;
 }
 
+/** 
+ * @description: 在子线程中为主线程交付的通信文件描述符创建连接，作为 CALLBACK 任务由 event_loop 所属线程调用
+ * @param {EventLoop*} event_loop: 负责该连接的反应堆模型
+ * @param {void*} arg: 服务器
+ * @param {int} fd: 通信文件描述符
+ */
+void TcpServer::createConnection(EventLoop* event_loop, void* arg, int fd) {
+	TcpServer* server = static_cast<TcpServer*>(arg);
+	new TcpConnection(fd, event_loop, server->m_edge_trigger, server->m_compute_pool);
+}
+
+/** 
+ * @description: 文件描述符耗尽且没有预留的文件描述符时暂停检测监听套接字，只能由执行 acceptConnection 的线程调用
+ * @description: 水平触发的监听套接字从反应堆模型中摘除；单次触发（领导者/跟随者模式）时不重新注册即可。m_accept_retry 毫秒后重新预留文件描述符并恢复检测
+ * @param {Listener*} listener: 监听器
+ */
+void TcpServer::pauseListener(Listener* listener) {
+	m_log->addTask("accept: too many open files, listener paused", 1);
+	Channel* channel = listener->channel;
+	EventLoop* event_loop = listener->event_loop == nullptr ? m_main_event_loop : listener->event_loop;
+	if (!channel->isOneShot()) {
+		event_loop->detach(channel);
+	}
+	event_loop->runAfter(m_accept_retry, [listener, channel, event_loop]() {
+		if (listener->idle_fd == -1) {
+			listener->idle_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+		}
+		event_loop->addTask(channel, channel->isOneShot() ? ElemType::MODIFY : ElemType::ADD);
+	});
+}
+
 
-TcpServer::TcpServer(unsigned short port, int thread_num) : m_port(port), m_thread_num(thread_num) {
-	m_main_event_loop = new EventLoop();
+/** 
+ * @param {unsigned short} port: 监听端口
+ * @param {int} thread_num: 子线程数量
+ * @param {DispatcherType} type: 反应堆模型的底层实现，AUTO 表示启动时自检选择，主线程与子线程使用相同的实现
+ * @param {int} expected_fds: AUTO 自检时模拟的连接数，应与实际部署的并发连接规模相当
+ */
+TcpServer::TcpServer(unsigned short port, int thread_num, DispatcherType type, int expected_fds) : m_port(port), m_thread_num(thread_num) {
+	m_main_event_loop = new EventLoop(std::string(), type, expected_fds);
 	m_thread_pool = new ThreadPool(m_main_event_loop, thread_num);
-	setListen();
 }
 
 /** 
  * @description: 设置监听函数，创建监听套接字，绑定端口并监听该端口是否有连接请求
+ * @param {bool} reuse_port: 是否设置 SO_REUSEPORT，允许多个监听套接字绑定同一端口
+ * @return {int} 成功返回监听文件描述符；失败返回 -1
  */
-void TcpServer::setListen() {
-	// 1. 创建用于监听的套接字
-	m_lfd = socket(AF_INET, SOCK_STREAM, 0);
-	if (m_lfd == -1) {
+int TcpServer::setListen(bool reuse_port) {
+	// 1. 创建用于监听的套接字，非阻塞以便每次监听事件批量 accept 直到 EAGAIN
+	int lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (lfd == -1) {
 		perror("socket");
-		return ;
+		return -1;
 	}
 
 	// 2. 设置端口复用，服务器主动断开连接后，一定时长内不会释放端口，通过端口复用可以在段时间内使用该端口
 	int opt = 1;
-	int ret = setsockopt(m_lfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof opt);
+	int ret = setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof opt);
 	if (ret == -1) {
 		perror("setsockopt");
-		return ;
+		close(lfd);
+		return -1;
+	}
+	// SO_REUSEPORT 允许多个套接字绑定同一端口，内核根据四元组哈希将新连接分配给其中一个监听套接字
+	if (reuse_port) {
+		ret = setsockopt(lfd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof opt);
+		if (ret == -1) {
+			perror("setsockopt reuseport");
+			close(lfd);
+			return -1;
+		}
 	}
 
 	// 3. 绑定端口
@@ -68,19 +182,240 @@ void TcpServer::setListen() {
 	// IP 范围是 0~255 对应一个 unsigned char 点分十进制 192.168.0.1 为四个 unsigned char 大小为四个字节，即一个 int 类型
 	// 0.0.0.0 表示本地的任意地址，宏为 INADDR_ANY
 	addr.sin_addr.s_addr = INADDR_ANY;  // 设置 IP 地址   
-	ret = bind(m_lfd, (struct sockaddr*)&addr, sizeof(struct sockaddr_in));
+	ret = bind(lfd, (struct sockaddr*)&addr, sizeof(struct sockaddr_in));
 	if (ret == -1) {
 		perror("bind");
-		return ;
+		close(lfd);
+		return -1;
 	}
 
 	// 4. 设置监听
-	ret = listen(m_lfd, 128);  // 128 表示监听过程中一次性最多可以连接的客户端数量
+	ret = listen(lfd, SOMAXCONN);  // 全连接队列长度，实际上限由内核参数 net.core.somaxconn 决定
 	if (ret == -1) {
 		perror("listen");
-		return ;
+		close(lfd);
+		return -1;
+	}
+	return lfd;
+}
+
+/** 
+ * @description: 创建监听器，将监听套接字封装为 channel 交给反应堆模型检测
+ * @param {EventLoop*} event_loop: 负责 accept 的子反应堆模型，nullptr 表示由主反应堆模型 accept
+ */
+void TcpServer::addListener(EventLoop* event_loop) {
+	int lfd = setListen(m_reuse_port);
+	if (lfd == -1) {
+		exit(0);
+	}
+
+	Listener* listener = new Listener;
+	listener->server = this;
+	listener->event_loop = event_loop;
+	listener->lfd = lfd;
+	listener->idle_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+	m_listeners.push_back(listener);
+
+	// 初始化一个 channel，封装监听套接字，并添加检测的任务
+	Channel* channel = new Channel(lfd, FDEvent::READEVENT, acceptConnection, nullptr, nullptr, listener);
+	channel->oneShotEnable(m_leader_follower != nullptr);  // 领导者/跟随者模式下由主反应堆模型转交给共享的 epoll 实例
+	listener->channel = channel;
+	if (event_loop == nullptr) {
+		m_main_event_loop->addTask(channel, ElemType::ADD);
+	}
+	else {
+		event_loop->addTask(channel, ElemType::ADD);  // 子线程正在运行，添加任务后会被唤醒
+	}
+}
+
+
+/** 
+ * @description: 将子线程依次绑定到处理网卡各个队列中断的 CPU 上，子线程多于队列时循环分配
+ * @param {string&} interface: 网卡名，例如 eth0
+ * @return {bool} 成功返回 true；找不到网卡队列的中断时返回 false，此时不修改绑核设置
+ */
+bool TcpServer::bindWorkersToNic(const std::string& interface) {
+	std::vector<int> queue_cpus = CpuAffinity::nicQueueCpus(interface);
+	if (queue_cpus.empty()) {
+		return false;
+	}
+	std::vector<int> cpus;
+	int count = m_max_threads > m_thread_num ? m_max_threads : m_thread_num;  // 动态扩容的子线程也需要绑核
+	for (int i = 0; i < count; ++i) {
+		cpus.push_back(queue_cpus[i % queue_cpus.size()]);
+	}
+	setWorkerCpus(cpus);
+	return true;
+}
+
+
+/** 
+ * @description: 由主反应堆模型的定时器周期调用，比较各个子反应堆模型的连接数量，差值超过阈值时让最忙的子线程把一半差值的空闲连接迁移给最闲的子线程
+ * @description: 迁移在最忙的子线程中执行，主线程只读取连接计数，不接触连接；IPHASH 策略下迁移会打破同一客户端固定在同一子线程的约定
+ */
+void TcpServer::rebalance() {
+	EventLoop* hot = nullptr;
+	EventLoop* cold = nullptr;
+	int hot_count = 0;
+	int cold_count = 0;
+	for (int i = 0; i < m_thread_pool->getThreadNum(); ++i) {
+		EventLoop* evLoop = m_thread_pool->getWorkerEventLoop(i);
+		int count = evLoop->getConnectionCount();
+		if (hot == nullptr || count > hot_count) {
+			hot = evLoop;
+			hot_count = count;
+		}
+		if (cold == nullptr || count < cold_count) {
+			cold = evLoop;
+			cold_count = count;
+		}
+	}
+	if (hot == cold || hot_count - cold_count <= m_rebalance_threshold) {
+		return;
+	}
+
+	int count = (hot_count - cold_count) / 2;
+	hot->queueInLoop([hot, cold, count]() {
+		TcpConnection::migrateIdle(hot, cold, count);
+	});
+}
+
+/** 
+ * @description: 将服务器的忙轮询、工作预算、长连接与看门狗设置应用到子反应堆模型，线程池启动时以及扩容时调用
+ * @param {EventLoop*} event_loop: 子反应堆模型
+ */
+void TcpServer::configureWorker(EventLoop* event_loop) {
+	event_loop->setBusyPoll(m_busy_poll_us);
+	event_loop->setWorkBudget(m_write_budget, m_turn_budget_us);
+	event_loop->setKeepAlive(m_idle_timeout, m_max_requests);
+	if (m_watchdog != nullptr) {
+		m_watchdog->watch(event_loop);
+	}
+}
+
+
+/** 
+ * @description: 由主反应堆模型的定时器周期调用，先推进退役子线程的排空，再根据利用率决定扩容或缩容
+ * @description: 利用率 = 两次检查之间各个子反应堆模型忙碌时间之和 / (间隔 * 子线程数量)，忙碌时间只包括处理就绪事件、定时器与任务的时间
+ * @description: 阻塞等待与忙轮询空转（非阻塞检测没有就绪事件）的时间都不计入，因此开启 setBusyPoll 后，子线程虽然一直占用 CPU，利用率仍然只反映实际工作量，负载低时同样会被退役
+ * @description: 平均利用率超过 75% 时增加一个子线程，低于 25% 时退役最后一个子线程，同一时间只退役一个，两个阈值之间留有余量避免来回抖动
+ */
+void TcpServer::scale() {
+	drain();
+
+	int64_t now = TimerWheel::nowUs();
+	int64_t elapsed = now - m_last_scale_time;
+	m_last_scale_time = now;
+	int num = m_thread_pool->getThreadNum();
+	if (elapsed <= 0 || num <= 0) {
+		return;
+	}
+
+	uint64_t busy = 0;
+	for (int i = 0; i < num; ++i) {
+		uint64_t total = m_thread_pool->getWorkerEventLoop(i)->getBusyTime();
+		busy += total - m_last_busy[i];
+		m_last_busy[i] = total;
+	}
+	double utilization = static_cast<double>(busy) / (static_cast<double>(elapsed) * num);
+
+	if (utilization > 0.75 && num < m_max_threads) {
+		EventLoop* evLoop = m_thread_pool->addWorker();
+		configureWorker(evLoop);
+		m_last_busy.push_back(evLoop->getBusyTime());
+		m_log->addTask("scale up to " + std::to_string(num + 1) + " workers, utilization " + std::to_string(static_cast<int>(utilization * 100)) + "%", 1);
+	}
+	else if (utilization < 0.25 && num > m_min_threads && m_retiring.empty()) {
+		retire();
+		m_log->addTask("scale down to " + std::to_string(num - 1) + " workers, utilization " + std::to_string(static_cast<int>(utilization * 100)) + "%", 1);
+	}
+}
+
+/** 
+ * @description: 从线程池中移除最后一个子线程，之后主线程不再给它分配新连接
+ * @description: 其他子线程（包括其他退役中的子线程）可能正在把连接迁移给它，因此给每个子线程投递一个栅栏任务，全部执行完之后它的连接计数不会再增加，才开始排空
+ */
+void TcpServer::retire() {
+	WorkerThread* worker = m_thread_pool->removeWorker();
+	if (worker == nullptr) {
+		return;
+	}
+	m_last_busy.pop_back();
+
+	std::vector<EventLoop*> loops;
+	for (int i = 0; i < m_thread_pool->getThreadNum(); ++i) {
+		loops.push_back(m_thread_pool->getWorkerEventLoop(i));
 	}
+	for (auto& item : m_retiring) {
+		loops.push_back(item.worker->getEventLoop());
+	}
+
+	RetiringWorker retiring;
+	retiring.worker = worker;
+	retiring.fences = std::make_shared<std::atomic<int>>(static_cast<int>(loops.size()));
+	for (auto evLoop : loops) {
+		std::shared_ptr<std::atomic<int>> fences = retiring.fences;
+		evLoop->queueInLoop([fences]() {
+			fences->fetch_sub(1);
+		});
+	}
+	m_retiring.push_back(retiring);
+}
 
+/** 
+ * @description: 推进退役子线程的排空：栅栏全部执行后，每次检查让它把空闲连接迁移给连接最少的子线程；正在收发或计算的连接等到空闲或关闭后再处理
+ * @description: 连接计数归零后，所有迁移任务都已在退役子线程中执行完毕，此时退出它的反应堆模型并回收线程
+ */
+void TcpServer::drain() {
+	for (auto item = m_retiring.begin(); item != m_retiring.end();) {
+		EventLoop* evLoop = item->worker->getEventLoop();
+		if (item->fences->load() > 0) {
+			++item;
+			continue;
+		}
+		if (evLoop->getConnectionCount() > 0) {
+			EventLoop* target = m_thread_pool->getWorkerEventLoop(0);
+			for (int i = 1; i < m_thread_pool->getThreadNum(); ++i) {
+				EventLoop* candidate = m_thread_pool->getWorkerEventLoop(i);
+				if (candidate->getConnectionCount() < target->getConnectionCount()) {
+					target = candidate;
+				}
+			}
+			int count = evLoop->getConnectionCount();
+			evLoop->queueInLoop([evLoop, target, count]() {
+				TcpConnection::migrateIdle(evLoop, target, count);
+			});
+			++item;
+			continue;
+		}
+
+		if (m_watchdog != nullptr) {
+			m_watchdog->unwatch(evLoop);
+		}
+		item->worker->stop();
+		delete item->worker;
+		item = m_retiring.erase(item);
+		m_log->addTask("worker retired", 1);
+	}
+}
+
+/** 
+ * @description: 汇总各个子反应堆模型的忙轮询统计，由主线程调用（子线程数量可能在运行期间变化）
+ * @return {BusyPollStats} 忙轮询统计
+ */
+BusyPollStats TcpServer::getBusyPollStats() {
+	BusyPollStats total = {0, 0, 0, 0};
+	if (m_leader_follower != nullptr) {  // 领导者/跟随者模式不使用子反应堆模型
+		return total;
+	}
+	for (int i = 0; i < m_thread_pool->getThreadNum(); ++i) {
+		BusyPollStats stats = m_thread_pool->getWorkerEventLoop(i)->getBusyPollStats();
+		total.spin_us += stats.spin_us;
+		total.work_us += stats.work_us;
+		total.spin_hits += stats.spin_hits;
+		total.blocks += stats.blocks;
+	}
+	return total;
 }
 
 
@@ -89,13 +424,69 @@ void TcpServer::setListen() {
  */
 void TcpServer::run() {
 	// 启动日志
-	Log::getInstance()->run();
+	Log::getInstance()->run(m_log_cpu);
+	// 启动计算线程池
+	if (m_compute_threads > 0) {
+		m_compute_pool = new ComputePool(m_compute_threads);
+		m_compute_pool->run();
+	}
+	// 领导者/跟随者模式（以及没有子线程时）连接的预算与长连接设置由主反应堆模型提供
+	m_main_event_loop->setWorkBudget(m_write_budget, m_turn_budget_us);
+	m_main_event_loop->setKeepAlive(m_idle_timeout, m_max_requests);
+	// 启动看门狗，子反应堆模型在 configureWorker 中加入检测；领导者/跟随者线程不是反应堆模型，只检测主反应堆模型
+	if (m_stall_threshold_ms > 0) {
+		m_watchdog = new Watchdog(m_stall_threshold_ms);
+		m_watchdog->watch(m_main_event_loop);
+		m_watchdog->run();
+	}
+	// 领导者/跟随者模式：启动共享 epoll 实例的线程，只创建一个监听器
+	if (m_threading_mode == ThreadingMode::LEADERFOLLOWER && m_thread_num > 0) {
+		m_leader_follower = new LeaderFollower(m_thread_num);
+		m_leader_follower->setCpus(m_worker_cpus);
+		m_main_event_loop->setLeaderFollower(m_leader_follower);
+		m_leader_follower->run();
+		addListener(nullptr);
+		CpuAffinity::bindCurrentThread(m_main_cpu);
+		m_main_event_loop->run();
+		return;
+	}
 	// 启动线程池
 	m_thread_pool->run();
-	// 初始化一个 channel，封装监听套接字
-	Channel* channel = new Channel(m_lfd, FDEvent::READEVENT, acceptConnection, nullptr, nullptr, this);
-	// 添加检测的任务
-	m_main_event_loop->addTask(channel, ElemType::ADD);
+	for (int i = 0; i < m_thread_num; ++i) {
+		configureWorker(m_thread_pool->getWorkerEventLoop(i));
+	}
+	// 动态扩缩容，SO_REUSEPORT 模式下每个子线程持有自己的监听套接字，不支持退役
+	// 初始线程数少于 min（包括为 0 的单反应堆模型）时先补足到 min，setScaling 保证 min 至少为 1
+	if (m_max_threads > m_min_threads && !m_reuse_port) {
+		while (m_thread_pool->getThreadNum() < m_min_threads) {
+			configureWorker(m_thread_pool->addWorker());
+		}
+		m_thread_num = m_thread_pool->getThreadNum();
+		for (int i = 0; i < m_thread_pool->getThreadNum(); ++i) {
+			m_last_busy.push_back(m_thread_pool->getWorkerEventLoop(i)->getBusyTime());
+		}
+		m_last_scale_time = TimerWheel::nowUs();
+		m_main_event_loop->runEvery(m_scale_interval, [this]() {
+			scale();
+		});
+	}
+	// 定时检查各个子线程的负载，迁移空闲连接
+	if (m_rebalance_interval > 0 && m_thread_num > 1) {
+		m_main_event_loop->runEvery(m_rebalance_interval, [this]() {
+			rebalance();
+		});
+	}
+	// 创建监听器，SO_REUSEPORT 模式下每个子反应堆模型各自监听，否则只由主反应堆模型监听
+	if (m_reuse_port && m_thread_num > 0) {
+		for (int i = 0; i < m_thread_num; ++i) {
+			addListener(m_thread_pool->getWorkerEventLoop(i));
+		}
+	}
+	else {
+		addListener(nullptr);
+	}
+	// 主线程绑核，放在其他线程启动之后，避免它们继承主线程的绑定（之后扩容的子线程由 WorkerThread 恢复为不绑定）
+	CpuAffinity::bindCurrentThread(m_main_cpu);
 	// 启动主线程反应堆模型
 	m_main_event_loop->run();
 }
@@ -0,0 +1,258 @@
+/** 
+ * @author: yuyuyuj1e 807152541@qq.com
+ * @github: https://github.com/yuyuyuj1e
+ * @csdn: https://blog.csdn.net/yuyuyuj1e
+ * @date: 2023-03-22 09:41:27
+ * @last_edit_time: 2023-03-22 09:41:27
+ * @file_path: /CC/src/Net/TimerWheel.cpp
+ * @description: 分层时间轮模块源文件
+ */
+
+#include "TimerWheel.h"
+#include <chrono>
+
+TimerWheel::TimerWheel() {
+	for (int i = 0; i < m_level0_size; ++i) {
+		m_level0[i] = nullptr;
+	}
+	for (int level = 0; level < m_levels - 1; ++level) {
+		for (int i = 0; i < m_level_size; ++i) {
+			m_upper[level][i] = nullptr;
+		}
+	}
+	m_expiring = nullptr;
+	m_current = nowMs();
+	m_next_id = 1;
+}
+
+TimerWheel::~TimerWheel() {
+	for (auto item : m_timers) {
+		delete item.second;
+	}
+}
+
+/**
+ * @description: 获取单调时钟的当前时间，不受系统时间调整的影响
+ * @return {int64_t} 当前时间（毫秒）
+ */
+int64_t TimerWheel::nowMs() {
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+}
+
+/**
+ * @description: 获取单调时钟的当前时间，精度更高，用于统计耗时
+ * @return {int64_t} 当前时间（微秒）
+ */
+int64_t TimerWheel::nowUs() {
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+/**
+ * @description: 申请一个定时器编号，其他线程可以先拿到编号，再把添加操作投递给所属线程
+ * @return {TimerId} 定时器编号
+ */
+TimerId TimerWheel::nextId() {
+	return m_next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @description: 将节点插入链表头部
+ * @param {TimerNode**} head: 链表头指针
+ * @param {TimerNode*} node: 定时器节点
+ */
+void TimerWheel::link(TimerNode** head, TimerNode* node) {
+	node->head = head;
+	node->prev = nullptr;
+	node->next = *head;
+	if (*head != nullptr) {
+		(*head)->prev = node;
+	}
+	*head = node;
+}
+
+/**
+ * @description: 将节点从所在链表中移除
+ * @param {TimerNode*} node: 定时器节点
+ */
+void TimerWheel::unlink(TimerNode* node) {
+	if (node->prev != nullptr) {
+		node->prev->next = node->next;
+	}
+	else {
+		*node->head = node->next;
+	}
+	if (node->next != nullptr) {
+		node->next->prev = node->prev;
+	}
+	node->prev = node->next = nullptr;
+	node->head = nullptr;
+}
+
+/**
+ * @description: 根据到期时间与当前时间的差值选择层级，再根据到期时间选择该层的槽位
+ * @param {TimerNode*} node: 定时器节点
+ */
+void TimerWheel::place(TimerNode* node) {
+	int64_t expire = node->expire > m_current ? node->expire : m_current + 1;  // 已经过期的定时器在下一毫秒执行
+	int64_t delta = expire - m_current;
+	if (delta < m_level0_size) {
+		link(&m_level0[expire & (m_level0_size - 1)], node);
+		return;
+	}
+
+	int shift = m_level0_bits;
+	for (int level = 0; level < m_levels - 1; ++level) {
+		if (delta < (1LL << (shift + m_level_bits)) || level == m_levels - 2) {
+			if (delta >= (1LL << (shift + m_level_bits))) {  // 超出最大范围，放在最后一层最远的槽位，降级时重新计算
+				expire = m_current + (1LL << (shift + m_level_bits)) - 1;
+			}
+			link(&m_upper[level][(expire >> shift) & (m_level_size - 1)], node);
+			return;
+		}
+		shift += m_level_bits;
+	}
+}
+
+/**
+ * @description: 取出上层槽位中的所有节点，按照新的剩余时间重新放入
+ * @param {TimerNode**} head: 上层槽位的链表头指针
+ */
+void TimerWheel::cascade(TimerNode** head) {
+	TimerNode* node = *head;
+	*head = nullptr;
+	while (node != nullptr) {
+		TimerNode* next = node->next;
+		place(node);
+		node = next;
+	}
+}
+
+/**
+ * @description: 时间轮前进 1 毫秒，第 0 层转完一圈时先从上层降级，再执行当前槽位中到期的定时器
+ */
+void TimerWheel::tick() {
+	++m_current;
+	int index = m_current & (m_level0_size - 1);
+	if (index == 0) {
+		int shift = m_level0_bits;
+		for (int level = 0; level < m_levels - 1; ++level) {
+			int upper_index = (m_current >> shift) & (m_level_size - 1);
+			cascade(&m_upper[level][upper_index]);
+			if (upper_index != 0) {  // 本层还没转完一圈，不需要继续降级更上层
+				break;
+			}
+			shift += m_level_bits;
+		}
+	}
+
+	// 将当前槽位整体移到执行链表中，回调中取消其他定时器时可以直接从执行链表中删除
+	m_expiring = m_level0[index];
+	m_level0[index] = nullptr;
+	for (TimerNode* node = m_expiring; node != nullptr; node = node->next) {
+		node->head = &m_expiring;
+	}
+
+	while (m_expiring != nullptr) {
+		TimerNode* node = m_expiring;
+		unlink(node);
+		if (node->interval > 0) {  // 重复执行的定时器，回调中取消自身时 interval 会被置 0
+			node->expire += node->interval;
+			node->callback();
+			if (node->interval > 0) {
+				place(node);
+			}
+			else {
+				delete node;
+			}
+		}
+		else {
+			m_timers.erase(node->id);
+			node->callback();
+			delete node;
+		}
+	}
+}
+
+/**
+ * @description: 添加定时器，只能由所属线程调用
+ * @param {TimerId} id: 通过 nextId 申请的定时器编号
+ * @param {int64_t} delay: 延迟时间（毫秒）
+ * @param {int64_t} interval: 重复间隔（毫秒），0 表示只执行一次
+ * @param {function<void()>} callback: 到期回调
+ */
+void TimerWheel::add(TimerId id, int64_t delay, int64_t interval, std::function<void()> callback) {
+	if (m_timers.empty()) {  // 没有定时器时时间轮不会前进，先对齐到当前时间
+		m_current = nowMs();
+	}
+	TimerNode* node = new TimerNode;
+	node->id = id;
+	node->expire = nowMs() + (delay > 0 ? delay : 0);
+	node->interval = interval > 0 ? interval : 0;
+	node->callback = std::move(callback);
+	place(node);
+	m_timers.insert(std::make_pair(id, node));
+}
+
+/**
+ * @description: 取消定时器，只能由所属线程调用
+ * @param {TimerId} id: 定时器编号
+ * @return {bool} 成功返回 true；定时器不存在（或已经执行）返回 false
+ */
+bool TimerWheel::cancel(TimerId id) {
+	auto item = m_timers.find(id);
+	if (item == m_timers.end()) {
+		return false;
+	}
+	TimerNode* node = item->second;
+	m_timers.erase(item);
+	if (node->head == nullptr) {  // 正在执行回调的重复定时器，由 tick 负责释放
+		node->interval = 0;
+		return true;
+	}
+	unlink(node);
+	delete node;
+	return true;
+}
+
+/**
+ * @description: 推进时间轮到指定时间，依次执行期间到期的定时器
+ * @param {int64_t} now: 当前时间（毫秒）
+ */
+void TimerWheel::advance(int64_t now) {
+	if (m_timers.empty()) {
+		m_current = now > m_current ? now : m_current;
+		return;
+	}
+	while (m_current < now) {
+		tick();
+	}
+}
+
+/**
+ * @description: 计算 dispatch 的超时时间，在第 0 层本圈剩余的槽位中查找第一个非空槽位，找不到时在下一次降级时醒来
+ * @param {int} max_timeout: 超时时间上限（毫秒）
+ * @return {int} 超时时间（毫秒）
+ */
+int TimerWheel::nextTimeout(int max_timeout) {
+	if (m_timers.empty()) {
+		return max_timeout;
+	}
+
+	int64_t now = nowMs();
+	int64_t limit = m_current + m_level0_size - (m_current & (m_level0_size - 1));  // 下一次降级的时间
+	int64_t target = limit;
+	for (int64_t t = m_current + 1; t < limit && t - now < max_timeout; ++t) {
+		if (m_level0[t & (m_level0_size - 1)] != nullptr) {
+			target = t;
+			break;
+		}
+	}
+
+	int64_t timeout = target - now;
+	if (timeout < 0) {
+		return 0;
+	}
+	return timeout < max_timeout ? static_cast<int>(timeout) : max_timeout;
+}
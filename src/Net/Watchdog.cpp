@@ -0,0 +1,169 @@
+/** 
+ * @author: yuyuyuj1e 807152541@qq.com
+ * @github: https://github.com/yuyuyuj1e
+ * @csdn: https://blog.csdn.net/yuyuyuj1e
+ * @date: 2023-03-27 15:06:42
+ * @last_edit_time: 2023-03-27 15:06:42
+ * @file_path: /CC/src/Net/Watchdog.cpp
+ * @description: 事件循环看门狗源文件
+ */
+
+#include "Watchdog.h"
+#include <chrono>
+
+/** 
+ * @param {int} threshold_ms: 阻塞阈值（毫秒），一轮处理时间超过该值时报告
+ */
+Watchdog::Watchdog(int threshold_ms) : m_threshold_ms(threshold_ms > 0 ? threshold_ms : 1) {
+	m_thread = nullptr;
+	m_quit = false;
+}
+
+Watchdog::~Watchdog() {
+	m_quit = true;
+	if (m_thread != nullptr) {
+		m_thread->join();
+		delete m_thread;
+	}
+	for (auto& watched : m_watched) {
+		watched.event_loop->setWatched(false);
+	}
+}
+
+/** 
+ * @description: 启动看门狗线程
+ */
+void Watchdog::run() {
+	m_thread = new std::thread(&Watchdog::running, this);
+}
+
+/** 
+ * @description: 添加被检测的反应堆模型，被检测后连接才会发布请求行
+ * @param {EventLoop*} event_loop: 反应堆模型
+ */
+void Watchdog::watch(EventLoop* event_loop) {
+	std::lock_guard<std::mutex> locker(m_mutex);
+	Watched watched;
+	watched.event_loop = event_loop;
+	watched.reported_start = 0;
+	watched.stalls = 0;
+	watched.reported_stalls = 0;
+	m_watched.push_back(watched);
+	event_loop->setWatched(true);
+}
+
+/** 
+ * @description: 移除被检测的反应堆模型，返回后看门狗不会再访问它
+ * @param {EventLoop*} event_loop: 反应堆模型
+ */
+void Watchdog::unwatch(EventLoop* event_loop) {
+	std::lock_guard<std::mutex> locker(m_mutex);
+	for (auto item = m_watched.begin(); item != m_watched.end(); ++item) {
+		if (item->event_loop == event_loop) {
+			event_loop->setWatched(false);
+			m_watched.erase(item);
+			break;
+		}
+	}
+}
+
+/** 
+ * @description: 线程函数，每半个阈值检测一次，阻塞最晚在超过阈值半个周期后被发现
+ */
+void Watchdog::running() {
+	int period = m_threshold_ms / 2 > 0 ? m_threshold_ms / 2 : 1;
+	int64_t next_report = TimerWheel::nowMs() + m_report_interval_ms;
+	while (!m_quit) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(period));
+		int64_t now = TimerWheel::nowUs();
+		std::lock_guard<std::mutex> locker(m_mutex);
+		for (auto& watched : m_watched) {
+			check(watched, now);
+		}
+		if (now / 1000 >= next_report) {
+			report();
+			next_report = now / 1000 + m_report_interval_ms;
+		}
+	}
+}
+
+/** 
+ * @description: 检测一个反应堆模型，本轮开始处理的时间距今超过阈值时报告阻塞信息
+ * @param {Watched&} watched: 被检测的反应堆模型
+ * @param {int64_t} now: 当前时间（微秒）
+ */
+void Watchdog::check(Watched& watched, int64_t now) {
+	LoopHeartbeat heartbeat = watched.event_loop->getHeartbeat();
+	if (heartbeat.iteration_start == 0 || heartbeat.iteration_start == watched.reported_start) {  // 正在等待事件，或者本轮已经报告过
+		return;
+	}
+	int64_t elapsed = now - heartbeat.iteration_start;
+	if (elapsed < static_cast<int64_t>(m_threshold_ms) * 1000) {
+		return;
+	}
+
+	watched.reported_start = heartbeat.iteration_start;
+	++watched.stalls;
+	std::string msg = "stall: " + watched.event_loop->getThreadName() + " blocked " + std::to_string(elapsed / 1000) + "ms in " + stageName(heartbeat.stage);
+	if (heartbeat.fd != -1) {
+		msg += ", fd " + std::to_string(heartbeat.fd);
+	}
+	if (!heartbeat.label.empty()) {
+		msg += ", request " + heartbeat.label;
+	}
+	msg += ", iteration " + std::to_string(heartbeat.iterations);
+	m_log->addTask(msg, 1);
+}
+
+/** 
+ * @description: 输出上一次输出之后出现过阻塞的反应堆模型的耗时分布
+ */
+void Watchdog::report() {
+	for (auto& watched : m_watched) {
+		if (watched.stalls == watched.reported_stalls) {
+			continue;
+		}
+		watched.reported_stalls = watched.stalls;
+		m_log->addTask("stall histogram: " + watched.event_loop->getThreadName() + " " + std::to_string(watched.stalls) + " stalls, " + histogram(watched.event_loop), 1);
+	}
+}
+
+/** 
+ * @description: 格式化反应堆模型的耗时分布，省略计数为 0 的桶
+ * @param {EventLoop*} event_loop: 反应堆模型
+ * @return {string} 例如 "<1ms:1520 1-2ms:31 64-128ms:2"
+ */
+std::string Watchdog::histogram(EventLoop* event_loop) {
+	std::vector<uint64_t> counts = event_loop->getStallHistogram();
+	std::string text;
+	for (size_t i = 0; i < counts.size(); ++i) {
+		if (counts[i] == 0) {
+			continue;
+		}
+		if (!text.empty()) {
+			text += ' ';
+		}
+		text += EventLoop::stallBucketName(static_cast<int>(i)) + ':' + std::to_string(counts[i]);
+	}
+	return text;
+}
+
+/** 
+ * @description: 阶段名称
+ * @param {LoopStage} stage: 阶段
+ * @return {const char*} 名称
+ */
+const char* Watchdog::stageName(LoopStage stage) {
+	switch (stage) {
+	case LoopStage::READ:
+		return "read callback";
+	case LoopStage::WRITE:
+		return "write callback";
+	case LoopStage::TIMER:
+		return "timer";
+	case LoopStage::TASK:
+		return "task queue";
+	default:
+		return "dispatch";
+	}
+}
@@ -30,32 +30,64 @@
  * @last_edit_time: 2023-03-08 09:58:36
  * @file_path: /CC/src/main.cpp
  * @description: 程序主函数，设置 DEBUG__ 后，可以直接启动程序，无需设置端口以及所需路径，否则需要在可执行文件后添加两个命令行参数
+ * @description: 之后的可选参数依次为反应堆模型的底层实现：epoll（默认）、poll、select、io_uring 或 auto；线程模型：reactor（默认，主从反应堆）或 lf（领导者/跟随者）
+ * @description: 然后是线程数量：N（默认 4）或 min-max，后者在主从反应堆模型下按照利用率在范围内动态扩缩容，初始为 min
+ * @description: 然后是计算线程数量（默认 0，不使用计算线程池），大于 0 时目录页面等响应体交给计算线程生成
+ * @description: 最后是 auto 自检时模拟的连接数（默认 256），应与实际部署的并发连接规模相当
  */
 
 #include <iostream>
 #include <unistd.h>
 #include <stdlib.h>
 #include "TcpServer.h"
+#include "DispatcherSelector.h"
 
 #define DEBUG__
 
 int main(int argc, const char** argv) {
 #ifndef DEBUG__
     if (argc < 3) {
-        std::cout << "you need input ./a.out port path\n" << std::endl;
+        std::cout << "you need input ./a.out port path [epoll|poll|select|io_uring|auto] [reactor|lf] [threads|min-max] [compute_threads] [expected_fds]\n" << std::endl;
     }
 
     unsigned short port = atoi(argv[1]);  // 获取端口
     chdir(argv[2]);  // 切换服务器工作路径
+    std::string backend = argc > 3 ? argv[3] : "epoll";  // 获取底层实现
+    std::string mode = argc > 4 ? argv[4] : "reactor";  // 获取线程模型
+    std::string threads = argc > 5 ? argv[5] : "4";  // 获取线程数量
+    int compute_threads = argc > 6 ? atoi(argv[6]) : 0;  // 获取计算线程数量
+    int expected_fds = argc > 7 ? atoi(argv[7]) : 256;  // auto 自检时模拟的连接数
 #endif // !DEBUG__
 
 #ifdef DEBUG__
     unsigned short port = 10000;  // 获取端口
     chdir("/home/ubuntu/桌面/tt/");  // 切换服务器工作路径
+    std::string backend = argc > 1 ? argv[1] : "epoll";  // 获取底层实现
+    std::string mode = argc > 2 ? argv[2] : "reactor";  // 获取线程模型
+    std::string threads = argc > 3 ? argv[3] : "4";  // 获取线程数量
+    int compute_threads = argc > 4 ? atoi(argv[4]) : 0;  // 获取计算线程数量
+    int expected_fds = argc > 5 ? atoi(argv[5]) : 256;  // auto 自检时模拟的连接数
 #endif // DEBUG__
 
+    // 解析线程数量，min-max 形式表示动态扩缩容
+    int min_threads = atoi(threads.c_str());
+    int max_threads = min_threads;
+    size_t dash = threads.find('-');
+    if (dash != std::string::npos) {
+        max_threads = atoi(threads.c_str() + dash + 1);
+    }
+
     // 启动服务器
-    TcpServer* server = new TcpServer(port, 4);
+    TcpServer* server = new TcpServer(port, min_threads, DispatcherSelector::parse(backend), expected_fds);
+    if (mode == "lf") {
+        server->setThreadingMode(ThreadingMode::LEADERFOLLOWER);
+    }
+    if (compute_threads > 0) {
+        server->setComputeThreads(compute_threads);
+    }
+    if (max_threads > min_threads) {
+        server->setScaling(min_threads, max_threads);
+    }
     server->run();
     return 0;
 }
\ No newline at end of file